@@ -1,5 +1,11 @@
 set(headers ${headers}
 	src/Manager.h
+	src/Overrides.h
 	src/PCH.h
 	src/Settings.h
+	src/Staging.h
+	src/Trace.h
+	src/Water.h
+	src/WaterAtlas.h
+	src/WaterAtlasFormat.h
 )
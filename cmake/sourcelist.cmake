@@ -1,6 +1,12 @@
 set(sources ${sources}
 	src/Manager.cpp
+	src/Overrides.cpp
 	src/PCH.cpp
 	src/Settings.cpp
+	src/Staging.cpp
+	src/Trace.cpp
+	src/Water.cpp
+	src/WaterAtlas.cpp
+	src/WaterAtlasFormat.cpp
 	src/main.cpp
 )
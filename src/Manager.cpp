@@ -15,46 +15,27 @@ namespace Splashes
 
 	float util::get_water_height(const RE::TESObjectREFR* a_ref, const RE::NiPoint3& a_pos)
 	{
-		float waterHeight = -RE::NI_INFINITY;
+		SPLASH_TRACE("get_water_height");
 
-		if (const auto waterManager = RE::TESWaterSystem::GetSingleton()) {
-			waterHeight = a_ref->GetWaterHeight();
+		const auto cell = a_ref->GetParentCell();
+		if (!cell) {
+			return Water::WaterObjects::GetSingleton()->GetHeight(a_pos);
+		}
 
-			if (!numeric::essentially_equal(waterHeight, -RE::NI_INFINITY)) {
-				return waterHeight;
+		// cell water, cached on the main thread as cells load, the atlas covers cells that haven't been evaluated yet
+		auto cellWaterHeight = Water::CellWater::GetSingleton()->GetWaterHeight(cell);
+		if (!cellWaterHeight) {
+			const auto worldSpace = cell->worldSpace;
+			if (const auto atlasCell = worldSpace ? Water::Atlas::GetSingleton()->GetCell(worldSpace->GetFormID(), a_ref->GetPosition()) : nullptr) {
+				cellWaterHeight = atlasCell->height;
 			}
+		}
+		if (cellWaterHeight && !numeric::essentially_equal(*cellWaterHeight, -RE::NI_INFINITY)) {
+			return *cellWaterHeight;
+		}
 
-			const auto get_nearest_water_object_height = [&]() {
-				const auto settings = Settings::GetSingleton();
-				for (const auto& waterObject : waterManager->waterObjects) {
-					if (waterObject) {
-						if (!settings->GetAllowDamageWater()) {
-							if (const auto waterForm = waterObject->waterType; waterForm && waterForm->GetDangerous()) {
-								continue;
-							}
-						}
-						for (const auto& bound : waterObject->multiBounds) {
-							if (bound) {
-								if (auto size{ bound->size }; size.z <= 10.0f) {  //avoid sloped water
-									auto       center{ bound->center };
-									const auto boundMin = center - size;
-									const auto boundMax = center + size;
-									if (!(a_pos.x < boundMin.x || a_pos.x > boundMax.x || a_pos.y < boundMin.y || a_pos.y > boundMax.y)) {
-										return center.z;
-									}
-								}
-							}
-						}
-					}
-				}
-
-				return -RE::NI_INFINITY;
-			};
-
-			waterHeight = get_nearest_water_object_height();
-		}
-
-		return waterHeight;
+		// lakes, rivers and placed water
+		return Water::WaterObjects::GetSingleton()->GetHeight(a_pos);
 	}
 
 	std::pair<float, float> util::get_submerged_water_level(const RE::TESObjectREFR* a_ref, const RE::NiPoint3& a_pos)
@@ -73,6 +54,8 @@ namespace Splashes
 
 	void util::create_ripple(const RE::NiPoint3& a_pos, float a_displacementMult)
 	{
+		SPLASH_TRACE("create_ripple");
+
 		const auto displacement = 0.0099999998f * a_displacementMult;
 
 		if (const auto taskPool = RE::TaskQueueInterface::GetSingleton()) {
@@ -80,9 +63,102 @@ namespace Splashes
 		}
 	}
 
+	const LODBand* util::get_lod_band(const RE::NiPoint3& a_pos)
+	{
+		const auto cameraPos = FrameState::GetSingleton()->GetCameraPos();
+		if (!cameraPos) {
+			return nullptr;
+		}
+
+		return Settings::GetSingleton()->GetLODBand(cameraPos->GetSquaredDistance(a_pos));
+	}
+
+	void FrameState::Install()
+	{
+		REL::Relocation<std::uintptr_t> target{ RELOCATION_ID(35565, 36564) };
+#ifndef SKYRIMVR
+		stl::write_thunk_call<MainUpdate>(target.address() + OFFSET(0x748, 0xC26));
+#else
+		stl::write_thunk_call<MainUpdate>(target.address() + 0x7EE);
+#endif
+
+		logger::info("Installed {}"sv, typeid(FrameState).name());
+	}
+
+	std::optional<RE::NiPoint3> FrameState::GetCameraPos()
+	{
+		std::shared_lock sharedLock(lock);
+		return cameraPos;
+	}
+
+	void FrameState::MainUpdate::thunk()
+	{
+		func();
+
+		GetSingleton()->Update();
+
+		SPLASH_TRACE_FRAME();
+	}
+
+	void FrameState::Update()
+	{
+		SPLASH_TRACE("FrameState::Update");
+
+		const auto camera = RE::PlayerCamera::GetSingleton();
+		const auto cameraRoot = camera ? camera->cameraRoot.get() : nullptr;
+		{
+			std::unique_lock uniqueLock(lock);
+			cameraPos = cameraRoot ? std::optional(cameraRoot->world.translate) : std::nullopt;
+		}
+
+		Water::WaterObjects::GetSingleton()->Update();
+	}
+
+	std::optional<RE::NiPoint3> ProjectileHistory::exchange(RE::RefHandle a_handle, const RE::NiPoint3& a_pos)
+	{
+		if (a_handle == 0) {
+			return std::nullopt;
+		}
+
+		thread_local Table table;
+
+		const auto time = RE::GetDurationOfApplicationRunTime();
+
+		// projectiles that stopped updating are swept out at most once per staleTime
+		if (time - table.lastPrune > staleTime) {
+			std::erase_if(table.entries, [&](const auto& a_entry) {
+				return time - a_entry.second.time > staleTime;
+			});
+			table.lastPrune = time;
+		}
+
+		auto [it, inserted] = table.entries.try_emplace(a_handle, Entry{ a_pos, time });
+		if (inserted) {
+			return std::nullopt;
+		}
+
+		const auto last = std::exchange(it->second, Entry{ a_pos, time });
+		if (time - last.time > staleTime) {
+			return std::nullopt;
+		}
+		return last.pos;
+	}
+
 	void InstallOnPostLoad()
 	{
-		Settings::GetSingleton()->LoadSettings();
+		const auto settings = Settings::GetSingleton();
+		settings->LoadSettings();
+
+#ifndef TRACY_ENABLE
+		if (settings->GetTraceEvents()) {
+			if (auto path = logger::log_directory()) {
+				*path /= fmt::format(FMT_STRING("{}_trace.json"), Version::PROJECT);
+				Trace::Writer::GetSingleton()->Start(*path);
+			}
+		}
+#endif
+
+		FrameState::Install();
 
 		ProjectileManager<RE::MissileProjectile, kMissile>::Install();
 		ProjectileManager<RE::FlameProjectile, kFlame>::Install();
@@ -96,6 +172,11 @@ namespace Splashes
 	void InstallOnDataLoad()
 	{
 		const auto settings = Settings::GetSingleton();
+
+		Overrides::GetSingleton()->Resolve(settings->GetOverrides());
+		Water::Atlas::GetSingleton()->LoadOrBake();
+		Water::CellWater::Register();
+
 		if (!settings->GetPatchDisplacement()) {
 			return;
 		}
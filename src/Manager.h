@@ -1,6 +1,11 @@
 #pragma once
 
+#include "Overrides.h"
 #include "Settings.h"
+#include "Staging.h"
+#include "Trace.h"
+#include "Water.h"
+#include "WaterAtlas.h"
 
 namespace Splashes
 {
@@ -17,6 +22,51 @@ namespace Splashes
 		static float                   get_water_height(const RE::TESObjectREFR* a_ref, const RE::NiPoint3& a_pos);
 		static std::pair<float, float> get_submerged_water_level(const RE::TESObjectREFR* a_ref, const RE::NiPoint3& a_pos);
 		static void                    create_ripple(const RE::NiPoint3& a_pos, float a_displacementMult);
+		static const LODBand*          get_lod_band(const RE::NiPoint3& a_pos);
+	};
+
+	// engine state the hooks need, copied once per frame on the main thread so they never read it themselves
+	class FrameState : public ISingleton<FrameState>
+	{
+	public:
+		static void Install();
+
+		[[nodiscard]] std::optional<RE::NiPoint3> GetCameraPos();
+
+	private:
+		struct MainUpdate
+		{
+			static void                                    thunk();
+			static inline REL::Relocation<decltype(thunk)> func;
+		};
+
+		void Update();
+
+		// members
+		std::shared_mutex           lock;
+		std::optional<RE::NiPoint3> cameraPos;
+	};
+
+	// position of in-flight projectiles on their previous update, kept per update thread so the hooks never share a lock
+	class ProjectileHistory
+	{
+	public:
+		static std::optional<RE::NiPoint3> exchange(RE::RefHandle a_handle, const RE::NiPoint3& a_pos);
+
+	private:
+		struct Entry
+		{
+			RE::NiPoint3  pos;
+			std::uint32_t time;
+		};
+
+		struct Table
+		{
+			std::unordered_map<RE::RefHandle, Entry> entries;  // handles carry an age, so a reused slot doesn't match
+			std::uint32_t                            lastPrune{ 0 };
+		};
+
+		static constexpr std::uint32_t staleTime = 1000;  // ms
 	};
 
 	template <class T, TYPE type>
@@ -32,6 +82,13 @@ namespace Splashes
 			{
 				func(a_projectile, a_delta);
 
+				SPLASH_TRACE("Update::thunk");
+
+				const auto cell = a_projectile->GetParentCell();
+				if (!cell || !Water::CellWater::GetSingleton()->HasWater(cell)) {
+					return;
+				}
+
 				if (!a_projectile->IsDisabled() && !a_projectile->IsDeleted()) {
 					if constexpr (type == kFlame || type == kBeam) {
 						RE::NiPoint3 startPos = a_projectile->GetPosition();
@@ -85,11 +142,25 @@ namespace Splashes
 							}
 						}
 
-						const auto startPos = a_projectile->GetPosition();
-						auto [height, level] = util::get_submerged_water_level(a_projectile, startPos);
-						if (level >= 0.01f && level < 1.0f) {
-							create_splash(a_projectile, { startPos.x, startPos.y, height });
+						const auto pos = a_projectile->GetPosition();
+						const auto lastPos = ProjectileHistory::exchange(a_projectile->GetHandle().native_handle(), pos);
+
+						// first update seen on this thread, fall back to the submersion window
+						if (!lastPos) {
+							auto [height, level] = util::get_submerged_water_level(a_projectile, pos);
+							if (level >= 0.01f && level < 1.0f) {
+								create_splash(a_projectile, { pos.x, pos.y, height });
+							}
+							return;
+						}
+
+						// splash where the segment travelled since the last update crosses the water surface
+						const auto waterHeight = util::get_water_height(a_projectile, pos);
+						if (numeric::essentially_equal(waterHeight, -RE::NI_INFINITY) || pos.z >= waterHeight || lastPos->z < waterHeight) {
+							return;
 						}
+						const auto t = numeric::approximately_equal(lastPos->z, pos.z) ? 1.0f : (waterHeight - lastPos->z) / (pos.z - lastPos->z);
+						create_splash(a_projectile, { (pos.x - lastPos->x) * t + lastPos->x, (pos.y - lastPos->y) * t + lastPos->y, waterHeight });
 					}
 				}
 			}
@@ -97,21 +168,41 @@ namespace Splashes
 
 			static void create_splash(const T* a_projectile, const RE::NiPoint3& a_pos)
 			{
+				SPLASH_TRACE("create_splash");
+
 				const auto root = a_projectile->Get3D();
 				if (!root || root->GetAppCulled()) {
 					return;
 				}
 
+				// only looked up once the projectile has hit water
+				const auto formOverride = Overrides::GetSingleton()->Find(a_projectile);
+				if (formOverride && formOverride->exclude) {
+					return;
+				}
+
 				const auto setting = Settings::GetSingleton();
 				const auto projectile = setting->GetProjectileSetting(type);
 
-				if (projectile->enableSplash) {
+				const auto lodBand = util::get_lod_band(a_pos);
+				if (lodBand && lodBand->mode == LOD_MODE::kNone) {
+					return;
+				}
+
+				const bool enableSplash = (!lodBand || lodBand->mode == LOD_MODE::kFull) && (formOverride && formOverride->enableSplash ? *formOverride->enableSplash : projectile->enableSplash);
+				const bool enableRipple = formOverride && formOverride->enableRipple ? *formOverride->enableRipple : projectile->enableRipple;
+
+				if (enableSplash) {
 					const float radius = root->worldBound.radius;
 					if (const auto cell = radius > 0.0f ?
 					                          a_projectile->GetParentCell() :
 					                          nullptr;
 						cell) {
-						float scale = 1.0f;
+						SplashRequest request{};
+						request.cell = cell;
+						request.cellFormID = cell->GetFormID();
+						request.pos = a_pos;
+						request.rotation = clib_util::RNG().generate<float>(-RE::NI_PI, RE::NI_PI);
 
 						if constexpr (type != kBeam) {
 							const auto heavyRadius = setting->GetSplashRadius(kHeavy);
@@ -121,70 +212,67 @@ namespace Splashes
 							if (radius <= heavyRadius) {
 								if (radius <= mediumRadius) {
 									if (radius > lightRadius) {
-										scale = setting->GetSplashScale(kLight);
+										request.scale = setting->GetSplashScale(kLight);
 									}
 								} else {
-									scale = setting->GetSplashScale(kMedium);
+									request.scale = setting->GetSplashScale(kMedium);
 								}
 							} else {
-								scale = setting->GetSplashScale(kHeavy);
+								request.scale = setting->GetSplashScale(kHeavy);
 							}
 
 							if constexpr (type == kMissile) {
-								RE::BSSoundHandle soundHandle{};
-
-								if (const auto audioManager = RE::BSAudioManager::GetSingleton(); audioManager) {
-									if (radius <= heavyRadius) {
-										if (radius <= mediumRadius) {
-											if (radius > lightRadius) {
-												audioManager->BuildSoundDataFromEditorID(soundHandle, "CWaterSmall", 17);
-											}
-										} else {
-											audioManager->BuildSoundDataFromEditorID(soundHandle, "CWaterMedium", 17);
+								if (radius <= heavyRadius) {
+									if (radius <= mediumRadius) {
+										if (radius > lightRadius) {
+											request.sound = "CWaterSmall";
 										}
 									} else {
-										audioManager->BuildSoundDataFromEditorID(soundHandle, "CWaterLarge", 17);
-									}
-									if (soundHandle.IsValid()) {
-										soundHandle.SetPosition(a_pos);
-										soundHandle.Play();
+										request.sound = "CWaterMedium";
 									}
+								} else {
+									request.sound = "CWaterLarge";
 								}
 							}
 						}
 
-						RE::NiMatrix3 matrix{};
-						matrix.SetEulerAnglesXYZ(-0.0f, -0.0f, clib_util::RNG().generate<float>(-RE::NI_PI, RE::NI_PI));
-
-						std::string modelName;
-						float       time;
-
 						if constexpr (type == kMissile || type == kCone || type == kFlame) {
 							switch (util::get_fire_type(root)) {
 							case FIRE_TYPE::kDragon:
-								modelName = projectile->modelPathDragon;
-								time = 2.0f;
+								request.modelName = projectile->modelPathDragon;
+								request.time = 2.0f;
 								break;
 							case FIRE_TYPE::kFire:
-								modelName = projectile->modelPathFire;
-								time = 1.0f;
+								request.modelName = projectile->modelPathFire;
 								break;
 							default:
-								modelName = projectile->modelPath;
-								time = 1.0f;
+								request.modelName = projectile->modelPath;
 								break;
 							}
 						} else {
-							modelName = projectile->modelPath;
-							time = 1.0f;
+							request.modelName = projectile->modelPath;
+						}
+
+						if (lodBand) {
+							request.scale *= lodBand->scaleMult;
+							if (!lodBand->modelPath.empty()) {
+								request.modelName = lodBand->modelPath;
+							}
 						}
 
-						RE::BSTempEffectParticle::Spawn(cell, time, modelName.c_str(), matrix, a_pos, scale, 7, nullptr);
+						if (formOverride) {
+							request.scale *= formOverride->scaleMult;
+							if (!formOverride->modelPath.empty()) {
+								request.modelName = formOverride->modelPath;
+							}
+						}
+
+						Staging::GetSingleton()->QueueSplash(std::move(request));
 					}
 				}
 
-				if (projectile->enableRipple) {
-					util::create_ripple(a_pos, projectile->displacementMult);
+				if (enableRipple) {
+					Staging::GetSingleton()->QueueRipple(a_pos, projectile->displacementMult);
 				}
 			}
 		};
@@ -270,6 +358,8 @@ namespace Splashes
 		static void create_explosion(const RE::Explosion* a_explosion, RE::TESObjectCELL* a_cell, RE::NiAVObject* a_root)
 		{
 			if (a_root) {
+				SPLASH_TRACE("create_explosion");
+
 				const auto setting = Settings::GetSingleton();
 				const auto explosionSetting = setting->GetExplosion();
 
@@ -277,50 +367,57 @@ namespace Splashes
 					return;
 				}
 
+				const auto formOverride = Overrides::GetSingleton()->Find(a_explosion);
+				if (formOverride && formOverride->exclude) {
+					return;
+				}
+
 				const auto         startPos = a_explosion->GetPosition();
 				const RE::NiPoint3 pos{ startPos.x, startPos.y, util::get_water_height(a_explosion, startPos) };
 
 				const auto type = util::get_fire_type(a_root);
-				if (!explosionSetting->fireOnly || type != FIRE_TYPE::kNone) {
-					a_root->SetAppCulled(true);
+				const auto lodBand = util::get_lod_band(pos);
+				if (lodBand && lodBand->mode == LOD_MODE::kNone) {
+					return;
+				}
 
-					std::string modelName;
-					float       time;
+				const bool enableSplash = (!lodBand || lodBand->mode == LOD_MODE::kFull) && (formOverride && formOverride->enableSplash ? *formOverride->enableSplash : true);
+				if (enableSplash && (!explosionSetting->fireOnly || type != FIRE_TYPE::kNone)) {
+					SplashRequest request{};
+					request.hideObject = RE::NiPointer(a_root);
+					request.cell = a_cell;
+					request.cellFormID = a_cell->GetFormID();
+					request.pos = pos;
+					request.scale = a_explosion->radius / setting->GetExplosionSplashRadius() * (lodBand ? lodBand->scaleMult : 1.0f);
+					request.rotation = clib_util::RNG().generate<float>(-RE::NI_PI, RE::NI_PI);
+					request.sound = "CWaterExplosionSplash";
+					request.soundNeedsEffect = true;
 
 					switch (type) {
 					case FIRE_TYPE::kDragon:
-						modelName = explosionSetting->modelPathDragon;
-						time = 2.0f;
+						request.modelName = explosionSetting->modelPathDragon;
+						request.time = 2.0f;
 						break;
 					case FIRE_TYPE::kFire:
-						modelName = explosionSetting->modelPathFire;
-						time = 1.0f;
+						request.modelName = explosionSetting->modelPathFire;
 						break;
 					default:
-						modelName = explosionSetting->modelPath;
-						time = 1.0f;
+						request.modelName = explosionSetting->modelPath;
 					}
 
-					const auto scale = a_explosion->radius / setting->GetExplosionSplashRadius();
-
-					RE::NiMatrix3 matrix{};
-					matrix.SetEulerAnglesXYZ(-0.0f, -0.0f, clib_util::RNG().generate<float>(-RE::NI_PI, RE::NI_PI));
-
-					if (const auto effect = RE::BSTempEffectParticle::Spawn(a_cell, time, modelName.c_str(), matrix, pos, scale, 7, nullptr)) {
-						RE::BSSoundHandle soundHandle{};
-
-						if (const auto audioManager = RE::BSAudioManager::GetSingleton()) {
-							audioManager->BuildSoundDataFromEditorID(soundHandle, "CWaterExplosionSplash", 17);
-						}
-
-						if (soundHandle.IsValid()) {
-							soundHandle.SetPosition(pos);
-							soundHandle.Play();
+					if (formOverride) {
+						request.scale *= formOverride->scaleMult;
+						if (!formOverride->modelPath.empty()) {
+							request.modelName = formOverride->modelPath;
 						}
 					}
+
+					Staging::GetSingleton()->QueueSplash(std::move(request));
 				}
 
-				util::create_ripple(pos, explosionSetting->displacementMult);
+				if (!formOverride || formOverride->enableRipple.value_or(true)) {
+					Staging::GetSingleton()->QueueRipple(pos, explosionSetting->displacementMult);
+				}
 			}
 		}
 	};
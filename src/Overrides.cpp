@@ -0,0 +1,197 @@
+#include "Overrides.h"
+
+namespace Splashes
+{
+	namespace detail
+	{
+		std::string_view trim(std::string_view a_str)
+		{
+			const auto begin = a_str.find_first_not_of(" \t");
+			if (begin == std::string_view::npos) {
+				return {};
+			}
+			const auto end = a_str.find_last_not_of(" \t");
+			return a_str.substr(begin, end - begin + 1);
+		}
+
+		bool is_plugin_name(std::string_view a_str)
+		{
+			if (a_str.size() < 4) {
+				return false;
+			}
+			const auto extension = a_str.substr(a_str.size() - 4);
+			return string::iequals(extension, ".esp"sv) || string::iequals(extension, ".esm"sv) || string::iequals(extension, ".esl"sv);
+		}
+	}
+
+	void Overrides::Resolve(const std::vector<std::pair<std::string, std::string>>& a_entries)
+	{
+		forms.clear();
+		plugins.clear();
+
+		const auto dataHandler = RE::TESDataHandler::GetSingleton();
+
+		for (const auto& [key, value] : a_entries) {
+			auto result = parse_override(value);
+			if (!result) {
+				logger::warn("Override {} : unrecognised value \"{}\""sv, key, value);
+				continue;
+			}
+
+			if (const auto pos = key.find('~'); pos != std::string::npos) {  // 0x123~Plugin.esp
+				const auto idStr = std::string_view(key).substr(0, pos);
+				const auto plugin = std::string_view(key).substr(pos + 1);
+				const auto begin = idStr.starts_with("0x"sv) || idStr.starts_with("0X"sv) ? idStr.data() + 2 : idStr.data();
+				RE::FormID rawID = 0;
+				const auto formID = std::from_chars(begin, idStr.data() + idStr.size(), rawID, 16).ec == std::errc{} ? dataHandler->LookupFormID(rawID, plugin) : 0;
+				if (formID == 0) {
+					logger::warn("Override {} : form not found"sv, key);
+					continue;
+				}
+				forms.emplace_back(formID, std::move(*result));
+			} else if (detail::is_plugin_name(key)) {
+				const auto file = dataHandler->LookupModByName(key);
+				if (!file || file->compileIndex == 0xFF) {
+					logger::warn("Override {} : plugin not loaded"sv, key);
+					continue;
+				}
+#ifndef SKYRIMVR
+				const std::uint32_t prefix = file->IsLight() ? 0xFE000000 | (static_cast<std::uint32_t>(file->smallFileCompileIndex) << 12) : static_cast<std::uint32_t>(file->compileIndex) << 24;
+#else
+				const std::uint32_t prefix = static_cast<std::uint32_t>(file->compileIndex) << 24;
+#endif
+				plugins.emplace_back(prefix, std::move(*result));
+			} else if (const auto form = RE::TESForm::LookupByEditorID(key)) {
+				forms.emplace_back(form->GetFormID(), std::move(*result));
+			} else {
+				logger::warn("Override {} : editorID not found (projectile, spell, ammo and explosion editorIDs need an editorID cache mod such as powerofthree's Tweaks)"sv, key);
+			}
+		}
+
+		// first entry wins on duplicates
+		const auto sort_unique = [](Table& a_table) {
+			std::ranges::stable_sort(a_table, {}, &Table::value_type::first);
+			const auto [first, last] = std::ranges::unique(a_table, {}, &Table::value_type::first);
+			a_table.erase(first, last);
+			a_table.shrink_to_fit();
+		};
+		sort_unique(forms);
+		sort_unique(plugins);
+
+		logger::info("Resolved {} form overrides and {} plugin overrides"sv, forms.size(), plugins.size());
+	}
+
+	const Override* Overrides::Find(const RE::Projectile* a_projectile) const
+	{
+		if (forms.empty() && plugins.empty()) {
+			return nullptr;
+		}
+
+		const std::array<const RE::TESForm*, 3> candidates{ a_projectile->GetBaseObject(), a_projectile->spell, a_projectile->ammoSource };
+		for (const auto& form : candidates) {
+			if (form) {
+				if (const auto result = lookup(forms, form->GetFormID())) {
+					return result;
+				}
+			}
+		}
+		for (const auto& form : candidates) {
+			if (form) {
+				if (const auto result = lookup(plugins, get_plugin_key(form->GetFormID()))) {
+					return result;
+				}
+			}
+		}
+
+		return nullptr;
+	}
+
+	const Override* Overrides::Find(const RE::Explosion* a_explosion) const
+	{
+		if (forms.empty() && plugins.empty()) {
+			return nullptr;
+		}
+
+		return Find(a_explosion->GetBaseObject());
+	}
+
+	const Override* Overrides::Find(const RE::TESForm* a_form) const
+	{
+		if (!a_form) {
+			return nullptr;
+		}
+
+		if (const auto result = lookup(forms, a_form->GetFormID())) {
+			return result;
+		}
+		return lookup(plugins, get_plugin_key(a_form->GetFormID()));
+	}
+
+	std::optional<Override> Overrides::parse_override(std::string_view a_value)
+	{
+		Override result{};
+
+		a_value = detail::trim(a_value);
+		if (string::iequals(a_value, "exclude"sv)) {
+			result.exclude = true;
+			return result;
+		}
+
+		const auto parse_bool = [](std::string_view a_str) -> std::optional<bool> {
+			if (string::iequals(a_str, "true"sv) || a_str == "1"sv) {
+				return true;
+			}
+			if (string::iequals(a_str, "false"sv) || a_str == "0"sv) {
+				return false;
+			}
+			return std::nullopt;
+		};
+
+		// Splash:false | Ripple:true | Scale:0.5 | Nif:Effects\waterSplashSmall.nif
+		while (!a_value.empty()) {
+			const auto separator = a_value.find('|');
+			const auto option = detail::trim(a_value.substr(0, separator));
+			a_value = separator == std::string_view::npos ? std::string_view{} : a_value.substr(separator + 1);
+
+			const auto colon = option.find(':');
+			if (colon == std::string_view::npos) {
+				return std::nullopt;
+			}
+			const auto name = detail::trim(option.substr(0, colon));
+			const auto arg = detail::trim(option.substr(colon + 1));
+
+			if (string::iequals(name, "splash"sv)) {
+				result.enableSplash = parse_bool(arg);
+				if (!result.enableSplash) {
+					return std::nullopt;
+				}
+			} else if (string::iequals(name, "ripple"sv)) {
+				result.enableRipple = parse_bool(arg);
+				if (!result.enableRipple) {
+					return std::nullopt;
+				}
+			} else if (string::iequals(name, "scale"sv)) {
+				if (std::from_chars(arg.data(), arg.data() + arg.size(), result.scaleMult).ec != std::errc{}) {
+					return std::nullopt;
+				}
+			} else if (string::iequals(name, "nif"sv)) {
+				result.modelPath = arg;
+			} else {
+				return std::nullopt;
+			}
+		}
+
+		return result;
+	}
+
+	std::uint32_t Overrides::get_plugin_key(RE::FormID a_formID)
+	{
+		return (a_formID >> 24) == 0xFE ? a_formID & 0xFFFFF000 : a_formID & 0xFF000000;
+	}
+
+	const Override* Overrides::lookup(const Table& a_table, std::uint32_t a_key)
+	{
+		const auto it = std::ranges::lower_bound(a_table, a_key, {}, &Table::value_type::first);
+		return it != a_table.end() && it->first == a_key ? &it->second : nullptr;
+	}
+}
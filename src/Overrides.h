@@ -0,0 +1,37 @@
+#pragma once
+
+namespace Splashes
+{
+	struct Override
+	{
+		bool                exclude{ false };
+		std::optional<bool> enableSplash{};
+		std::optional<bool> enableRipple{};
+		float               scaleMult{ 1.0f };
+		std::string         modelPath{};
+	};
+
+	// form and plugin overrides, resolved once on data load into sorted flat tables
+	class Overrides : public ISingleton<Overrides>
+	{
+	public:
+		void Resolve(const std::vector<std::pair<std::string, std::string>>& a_entries);
+
+		[[nodiscard]] const Override* Find(const RE::Projectile* a_projectile) const;
+		[[nodiscard]] const Override* Find(const RE::Explosion* a_explosion) const;
+
+	private:
+		using Table = std::vector<std::pair<std::uint32_t, Override>>;
+
+		[[nodiscard]] const Override* Find(const RE::TESForm* a_form) const;
+
+		static std::optional<Override> parse_override(std::string_view a_value);
+		static std::uint32_t           get_plugin_key(RE::FormID a_formID);
+
+		static const Override* lookup(const Table& a_table, std::uint32_t a_key);
+
+		// members
+		Table forms;
+		Table plugins;  // keyed by load order prefix of the FormID
+	};
+}
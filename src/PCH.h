@@ -9,8 +9,12 @@
 #include <ClibUtil/simpleINI.hpp>
 #include <ClibUtil/singleton.hpp>
 #include <ClibUtil/string.hpp>
+#include <mmio/mmio.hpp>
 #include <spdlog/sinks/basic_file_sink.h>
 #include <xbyak/xbyak.h>
+#ifdef TRACY_ENABLE
+#	include <tracy/Tracy.hpp>
+#endif
 #pragma warning(pop)
 
 #define DLLEXPORT __declspec(dllexport)
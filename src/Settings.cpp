@@ -2,6 +2,14 @@
 
 namespace Splashes
 {
+	LODBand::LODBand(std::string_view a_type, float a_distance, float a_scaleMult, LOD_MODE a_mode) :
+		type(a_type),
+		distance(a_distance),
+		distanceSq(a_distance * a_distance),
+		scaleMult(a_scaleMult),
+		mode(a_mode)
+	{}
+
 	Base::Base(std::string_view a_type, float a_displacementMult) :
 		type(a_type),
 		displacementMult(a_displacementMult)
@@ -34,6 +42,23 @@ namespace Splashes
 		ini::get_value(a_ini, modelPathDragon, type.c_str(), "sNifPathDragonFire", nullptr);
 	}
 
+	void LODBand::LoadSettings(CSimpleIniA& a_ini, bool a_writeComment)
+	{
+		const auto key = [&](std::string_view a_prefix, std::string_view a_name) {
+			return fmt::format("{}{}{}", a_prefix, type, a_name);
+		};
+
+		auto modeValue = std::to_underlying(mode);
+
+		ini::get_value(a_ini, distance, "LOD", key("f", "Distance").c_str(), a_writeComment ? ";Camera distance at which this band starts." : nullptr);
+		ini::get_value(a_ini, modeValue, "LOD", key("i", "Mode").c_str(), a_writeComment ? ";0 - splash and ripple, 1 - ripple only, 2 - nothing." : nullptr);
+		ini::get_value(a_ini, scaleMult, "LOD", key("f", "ScaleMult").c_str(), a_writeComment ? ";Splash scale multiplier." : nullptr);
+		ini::get_value(a_ini, modelPath, "LOD", key("s", "NifPath").c_str(), a_writeComment ? ";Cheaper projectile splash model for this band, path is relative to Data directory. Leave empty to use the default model.\n;Explosions use the band's mode and scale but keep their own model." : nullptr);
+
+		distanceSq = distance * distance;
+		mode = static_cast<LOD_MODE>(std::min(modeValue, std::to_underlying(LOD_MODE::kNone)));
+	}
+
 	void Explosion::LoadSettings(CSimpleIniA& a_ini)
 	{
 		ini::get_value(a_ini, enable, type.c_str(), "bEnable", nullptr);
@@ -75,6 +100,32 @@ namespace Splashes
 
 		explosion.LoadSettings(ini);
 
+		ini::get_value(ini, enableLOD, "LOD", "bEnable", ";Use cheaper splashes and ripples for projectile and explosion impacts far from the camera. Bands are checked far to near.");
+		lodMid.LoadSettings(ini, true);
+		lodFar.LoadSettings(ini);
+
+		// section comment, SimpleIni drops comments that trail the last key
+		ini.SetValue("Overrides", nullptr, nullptr,
+			";Per form/plugin overrides for projectiles, spells, ammo and explosions.\n"
+			";Key is a FormID (0x12345~Plugin.esp), EditorID or plugin name (Plugin.esp).\n"
+			";EditorIDs of projectiles, spells, ammo and explosions are discarded by the game, those keys need an editorID cache mod (such as powerofthree's Tweaks).\n"
+			";Value is Exclude, or any of Splash:bool | Ripple:bool | Scale:float | Nif:path\n"
+			";ExampleArrowsMod.esp = Exclude\n"
+			";0x12EB7~Skyrim.esm = Ripple:false | Scale:0.5");
+
+		CSimpleIniA::TNamesDepend keys;
+		ini.GetAllKeys("Overrides", keys);
+		keys.sort(CSimpleIniA::Entry::LoadOrder());
+
+		overrides.clear();
+		for (const auto& key : keys) {
+			if (const auto value = ini.GetValue("Overrides", key.pItem)) {
+				overrides.emplace_back(key.pItem, value);
+			}
+		}
+
+		ini::get_value(ini, traceEvents, "Debug", "bTraceEvents", ";Write per-frame splash timings to a chrome trace file (chrome://tracing) in the SKSE log directory.");
+
 		ini.SaveFile(path);
 	}
 
@@ -141,8 +192,32 @@ namespace Splashes
 		return allowDamageWater;
 	}
 
+	bool Settings::GetTraceEvents() const
+	{
+		return traceEvents;
+	}
+
 	float Settings::GetExplosionSplashRadius() const
 	{
 		return explosion.splashRadius;
 	}
+
+	const LODBand* Settings::GetLODBand(float a_distanceSq) const
+	{
+		if (!enableLOD) {
+			return nullptr;
+		}
+		if (a_distanceSq >= lodFar.distanceSq) {
+			return &lodFar;
+		}
+		if (a_distanceSq >= lodMid.distanceSq) {
+			return &lodMid;
+		}
+		return nullptr;
+	}
+
+	const std::vector<std::pair<std::string, std::string>>& Settings::GetOverrides() const
+	{
+		return overrides;
+	}
 }
@@ -19,6 +19,28 @@ namespace Splashes
 		kLight
 	};
 
+	enum class LOD_MODE : std::uint32_t
+	{
+		kFull = 0,
+		kRippleOnly,
+		kNone
+	};
+
+	struct LODBand
+	{
+		LODBand(std::string_view a_type, float a_distance, float a_scaleMult, LOD_MODE a_mode);
+
+		void LoadSettings(CSimpleIniA& a_ini, bool a_writeComment = false);
+
+		// members
+		std::string type{};
+		float       distance{};
+		float       distanceSq{};
+		std::string modelPath{};
+		float       scaleMult{ 1.0f };
+		LOD_MODE    mode{ LOD_MODE::kFull };
+	};
+
 	struct Base
 	{
 		Base(std::string_view a_type, float a_displacementMult);
@@ -69,13 +91,19 @@ namespace Splashes
 
 		[[nodiscard]] bool GetPatchDisplacement() const;
 		[[nodiscard]] bool GetAllowDamageWater() const;
+		[[nodiscard]] bool GetTraceEvents() const;
 
 		[[nodiscard]] float GetExplosionSplashRadius() const;
 
+		[[nodiscard]] const LODBand* GetLODBand(float a_distanceSq) const;
+
+		[[nodiscard]] const std::vector<std::pair<std::string, std::string>>& GetOverrides() const;
+
 	private:
 		// members
 		bool patchDisplacement{ true };
 		bool allowDamageWater{ false };
+		bool traceEvents{ false };
 
 		Projectile missile{ "Missile"sv, 1.0f };
 		Projectile flame{ "Flame"sv, 1.0f };
@@ -84,6 +112,10 @@ namespace Splashes
 		Projectile beam{ "Beam"sv, 0.4f };
 		Explosion  explosion{ "Explosion", 5.0f };
 
+		bool    enableLOD{ false };
+		LODBand lodMid{ "Mid"sv, 3000.0f, 0.75f, LOD_MODE::kFull };
+		LODBand lodFar{ "Far"sv, 6000.0f, 0.5f, LOD_MODE::kRippleOnly };
+
 		std::map<SIZE, float> splashRadii{
 			{ kHeavy, 35.0f },
 			{ kMedium, 20.0f },
@@ -95,5 +127,7 @@ namespace Splashes
 			{ kMedium, 0.75f },
 			{ kLight, 0.5f }
 		};
+
+		std::vector<std::pair<std::string, std::string>> overrides{};
 	};
 }
@@ -0,0 +1,104 @@
+#include "Staging.h"
+
+#include "Manager.h"
+
+namespace Splashes
+{
+	void Staging::QueueSplash(SplashRequest&& a_request)
+	{
+		const auto buffer = GetThreadBuffer();
+		{
+			std::scoped_lock lock(buffer->lock);
+			buffer->splashes.push_back(std::move(a_request));
+		}
+		RequestSubmit();
+	}
+
+	void Staging::QueueRipple(const RE::NiPoint3& a_pos, float a_displacementMult)
+	{
+		const auto buffer = GetThreadBuffer();
+		{
+			std::scoped_lock lock(buffer->lock);
+			buffer->ripples.push_back({ a_pos, a_displacementMult });
+		}
+		RequestSubmit();
+	}
+
+	Staging::Buffer* Staging::GetThreadBuffer()
+	{
+		thread_local Buffer* buffer = nullptr;
+		if (!buffer) {
+			std::scoped_lock lock(bufferLock);
+			buffer = buffers.emplace_back(std::make_unique<Buffer>()).get();
+		}
+		return buffer;
+	}
+
+	void Staging::RequestSubmit()
+	{
+		if (!submitQueued.exchange(true, std::memory_order_acq_rel)) {
+			SKSE::GetTaskInterface()->AddTask([this]() { Submit(); });
+		}
+	}
+
+	void Staging::Submit()
+	{
+		// runs once per frame on the main thread whenever there is splash work
+		SPLASH_TRACE("Staging::Submit");
+
+		// requests queued from here on schedule the next submit
+		submitQueued.store(false, std::memory_order_release);
+
+		{
+			std::scoped_lock lock(bufferLock);
+			for (const auto& buffer : buffers) {
+				std::scoped_lock swapLock(buffer->lock);
+				std::ranges::move(buffer->splashes, std::back_inserter(pendingSplashes));
+				std::ranges::move(buffer->ripples, std::back_inserter(pendingRipples));
+				buffer->splashes.clear();
+				buffer->ripples.clear();
+			}
+		}
+
+		for (const auto& splash : pendingSplashes) {
+			spawn_splash(splash);
+		}
+		for (const auto& ripple : pendingRipples) {
+			util::create_ripple(ripple.pos, ripple.displacementMult);
+		}
+
+		pendingSplashes.clear();
+		pendingRipples.clear();
+	}
+
+	void Staging::spawn_splash(const SplashRequest& a_request)
+	{
+		if (a_request.hideObject) {
+			a_request.hideObject->SetAppCulled(true);
+		}
+
+		if (RE::TESForm::LookupByID<RE::TESObjectCELL>(a_request.cellFormID) != a_request.cell || !a_request.cell->IsAttached()) {
+			return;
+		}
+
+		SPLASH_TRACE("BSTempEffectParticle::Spawn");
+
+		RE::NiMatrix3 matrix{};
+		matrix.SetEulerAnglesXYZ(-0.0f, -0.0f, a_request.rotation);
+
+		const auto effect = RE::BSTempEffectParticle::Spawn(a_request.cell, a_request.time, a_request.modelName.c_str(), matrix, a_request.pos, a_request.scale, 7, nullptr);
+
+		if (a_request.sound && (effect || !a_request.soundNeedsEffect)) {
+			RE::BSSoundHandle soundHandle{};
+
+			if (const auto audioManager = RE::BSAudioManager::GetSingleton()) {
+				audioManager->BuildSoundDataFromEditorID(soundHandle, a_request.sound, 17);
+			}
+
+			if (soundHandle.IsValid()) {
+				soundHandle.SetPosition(a_request.pos);
+				soundHandle.Play();
+			}
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+namespace Splashes
+{
+	struct SplashRequest
+	{
+		RE::TESObjectCELL* cell{ nullptr };
+		RE::FormID         cellFormID{ 0 };  // cell may unload before the request is submitted
+		std::string        modelName{};
+		RE::NiPoint3       pos{};
+		float              time{ 1.0f };
+		float              scale{ 1.0f };
+		float              rotation{ 0.0f };
+		const char*        sound{ nullptr };
+		bool               soundNeedsEffect{ false };  // only play the sound if the particle spawned
+
+		RE::NiPointer<RE::NiAVObject> hideObject{};  // culled on submit, explosions swap their own model for the splash
+	};
+
+	struct RippleRequest
+	{
+		RE::NiPoint3 pos{};
+		float        displacementMult{ 1.0f };
+	};
+
+	// hook threads only record requests, engine calls are made once per frame from the main thread
+	class Staging : public ISingleton<Staging>
+	{
+	public:
+		void QueueSplash(SplashRequest&& a_request);
+		void QueueRipple(const RE::NiPoint3& a_pos, float a_displacementMult);
+
+	private:
+		struct Buffer
+		{
+			std::mutex                 lock;  // only contended while the main thread swaps it out
+			std::vector<SplashRequest> splashes;
+			std::vector<RippleRequest> ripples;
+		};
+
+		Buffer* GetThreadBuffer();
+
+		void RequestSubmit();
+		void Submit();
+
+		static void spawn_splash(const SplashRequest& a_request);
+
+		// members
+		std::mutex                           bufferLock;
+		std::vector<std::unique_ptr<Buffer>> buffers;
+		std::atomic_bool                     submitQueued{ false };
+		std::vector<SplashRequest>           pendingSplashes;  // main thread only
+		std::vector<RippleRequest>           pendingRipples;   // main thread only
+	};
+}
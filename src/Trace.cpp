@@ -0,0 +1,97 @@
+#include "Trace.h"
+
+namespace Splashes::Trace
+{
+	void Writer::Start(const std::filesystem::path& a_path)
+	{
+		if (enabled) {
+			return;
+		}
+
+		output.open(a_path, std::ios::out | std::ios::trunc);
+		if (!output.is_open()) {
+			logger::error("Failed to open trace file {}"sv, a_path.string());
+			return;
+		}
+
+		// array format tolerates a missing closing bracket, so an unclean exit still yields a valid trace
+		output << "[\n";
+
+		thread = std::jthread([this](std::stop_token a_stop) { Run(a_stop); });
+		enabled = true;
+
+		logger::info("Writing trace events to {}"sv, a_path.string());
+	}
+
+	void Writer::Record(const char* a_name, std::uint64_t a_start, std::uint64_t a_end)
+	{
+		if (const auto ring = GetThreadRing()) {
+			ring->push({ a_name, a_start, a_end - a_start, false });
+		}
+	}
+
+	void Writer::MarkFrame()
+	{
+		if (!IsEnabled()) {
+			return;
+		}
+		if (const auto ring = GetThreadRing()) {
+			ring->push({ "Frame", Now(), 0, true });
+		}
+	}
+
+	std::uint64_t Writer::Now()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	Ring* Writer::GetThreadRing()
+	{
+		thread_local Ring* ring = nullptr;
+		if (!ring) {
+			std::scoped_lock lock(ringLock);
+			ring = rings.emplace_back(std::make_unique<Ring>(static_cast<std::uint32_t>(rings.size() + 1))).get();
+		}
+		return ring;
+	}
+
+	void Writer::Run(std::stop_token a_stop)
+	{
+		while (!a_stop.stop_requested()) {
+			std::this_thread::sleep_for(100ms);
+			Flush();
+		}
+		Flush();
+		output << "]\n";
+		output.close();
+	}
+
+	void Writer::Flush()
+	{
+		// rings are never freed, so only the list itself needs the lock; formatting and file writes happen outside it
+		std::vector<Ring*> snapshot;
+		{
+			std::scoped_lock lock(ringLock);
+			snapshot.reserve(rings.size());
+			for (const auto& ring : rings) {
+				snapshot.push_back(ring.get());
+			}
+		}
+
+		for (const auto& ring : snapshot) {
+			ring->drain([&](const Event& a_event) {
+				output << (firstEvent ? "" : ",\n");
+				if (a_event.frame) {
+					output << fmt::format(R"({{"name":"{}","cat":"frame","ph":"i","s":"g","ts":{},"pid":1,"tid":{}}})",
+						a_event.name, a_event.start, ring->threadID);
+				} else {
+					output << fmt::format(R"({{"name":"{}","cat":"splash","ph":"X","ts":{},"dur":{},"pid":1,"tid":{}}})",
+						a_event.name, a_event.start, a_event.duration, ring->threadID);
+				}
+				firstEvent = false;
+			});
+		}
+
+		output.flush();
+	}
+}
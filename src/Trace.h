@@ -0,0 +1,112 @@
+#pragma once
+
+namespace Splashes::Trace
+{
+	struct Event
+	{
+		const char*   name;
+		std::uint64_t start;  // microseconds
+		std::uint64_t duration;
+		bool          frame;  // instant frame boundary marker
+	};
+
+	// single producer (owning thread), single consumer (writer thread)
+	class Ring
+	{
+	public:
+		explicit Ring(std::uint32_t a_threadID) :
+			threadID(a_threadID)
+		{}
+
+		bool push(const Event& a_event)
+		{
+			const auto head = writePos.load(std::memory_order_relaxed);
+			if (head - readPos.load(std::memory_order_acquire) == capacity) {
+				return false;
+			}
+			events[head & (capacity - 1)] = a_event;
+			writePos.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		template <class F>
+		void drain(F&& a_func)
+		{
+			auto       tail = readPos.load(std::memory_order_relaxed);
+			const auto head = writePos.load(std::memory_order_acquire);
+			for (; tail != head; ++tail) {
+				a_func(events[tail & (capacity - 1)]);
+			}
+			readPos.store(tail, std::memory_order_release);
+		}
+
+		// members
+		std::uint32_t threadID;
+
+	private:
+		static constexpr std::size_t capacity = 4096;
+
+		std::array<Event, capacity>           events{};
+		alignas(64) std::atomic<std::size_t> writePos{ 0 };
+		alignas(64) std::atomic<std::size_t> readPos{ 0 };
+	};
+
+	// writes chrome trace-event json (chrome://tracing, perfetto)
+	class Writer : public ISingleton<Writer>
+	{
+	public:
+		void Start(const std::filesystem::path& a_path);
+
+		[[nodiscard]] bool IsEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+		void Record(const char* a_name, std::uint64_t a_start, std::uint64_t a_end);
+		void MarkFrame();
+
+		static std::uint64_t Now();
+
+	private:
+		Ring* GetThreadRing();
+
+		void Run(std::stop_token a_stop);
+		void Flush();
+
+		// members
+		std::atomic_bool                   enabled{ false };
+		std::mutex                         ringLock;
+		std::vector<std::unique_ptr<Ring>> rings;
+		std::ofstream                      output;
+		bool                               firstEvent{ true };
+		std::jthread                       thread;
+	};
+
+	class Scope
+	{
+	public:
+		explicit Scope(const char* a_name) :
+			name(Writer::GetSingleton()->IsEnabled() ? a_name : nullptr),
+			start(name ? Writer::Now() : 0)
+		{}
+		~Scope()
+		{
+			if (name) {
+				Writer::GetSingleton()->Record(name, start, Writer::Now());
+			}
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		// members
+		const char*   name;
+		std::uint64_t start;
+	};
+}
+
+#ifdef TRACY_ENABLE
+#	define SPLASH_TRACE(name) ZoneScopedN(name)
+#	define SPLASH_TRACE_FRAME() FrameMark
+#else
+#	define SPLASH_TRACE(name) const Splashes::Trace::Scope traceScope{ name }
+#	define SPLASH_TRACE_FRAME() Splashes::Trace::Writer::GetSingleton()->MarkFrame()
+#endif
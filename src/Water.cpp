@@ -0,0 +1,486 @@
+#include "Water.h"
+
+#include "Settings.h"
+#include "Trace.h"
+
+namespace Splashes::Water
+{
+	namespace detail
+	{
+		float half_to_float(std::uint16_t a_half)
+		{
+			const std::uint32_t sign = (a_half & 0x8000u) << 16;
+			std::uint32_t       exponent = (a_half >> 10) & 0x1Fu;
+			std::uint32_t       mantissa = a_half & 0x3FFu;
+
+			std::uint32_t bits;
+			if (exponent == 0) {
+				if (mantissa == 0) {
+					bits = sign;
+				} else {  // subnormal
+					exponent = 127 - 15 + 1;
+					while ((mantissa & 0x400u) == 0) {
+						mantissa <<= 1;
+						exponent--;
+					}
+					bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+				}
+			} else if (exponent == 0x1F) {
+				bits = sign | 0x7F800000u | (mantissa << 13);
+			} else {
+				bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+			}
+
+			return std::bit_cast<float>(bits);
+		}
+
+		RE::NiPoint3 get_vertex(const std::uint8_t* a_vertexData, std::uint32_t a_stride, bool a_fullPrecision, std::uint16_t a_index)
+		{
+			const auto vertex = a_vertexData + static_cast<std::size_t>(a_index) * a_stride;
+			if (a_fullPrecision) {
+				const auto pos = reinterpret_cast<const float*>(vertex);
+				return { pos[0], pos[1], pos[2] };
+			}
+			const auto pos = reinterpret_cast<const std::uint16_t*>(vertex);
+			return { half_to_float(pos[0]), half_to_float(pos[1]), half_to_float(pos[2]) };
+		}
+	}
+
+	HeightField::HeightField(const RE::BSMultiBoundAABB* a_bound)
+	{
+		heights.fill(-RE::NI_INFINITY);
+
+		const auto& center = a_bound->center;
+		const auto& extent = a_bound->size;
+
+		min = { center.x - extent.x, center.y - extent.y };
+		max = { center.x + extent.x, center.y + extent.y };
+		step = { (2.0f * extent.x) / (size - 1), (2.0f * extent.y) / (size - 1) };
+	}
+
+	void HeightField::Rasterize(const Triangle& a_triangle)
+	{
+		if (step.x <= 0.0f || step.y <= 0.0f) {
+			return;
+		}
+
+		const auto& [v0, v1, v2] = a_triangle;
+
+		const auto triMinX = std::min({ v0.x, v1.x, v2.x });
+		const auto triMaxX = std::max({ v0.x, v1.x, v2.x });
+		const auto triMinY = std::min({ v0.y, v1.y, v2.y });
+		const auto triMaxY = std::max({ v0.y, v1.y, v2.y });
+		if (triMaxX < min.x || triMinX > max.x || triMaxY < min.y || triMinY > max.y) {
+			return;
+		}
+
+		const float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+		if (numeric::essentially_equal(area, 0.0f)) {  // vertical in XY, no surface to sample
+			return;
+		}
+
+		const auto to_sample = [](float a_value, float a_min, float a_step) {
+			return std::clamp(a_value - a_min, 0.0f, a_step * (size - 1)) / a_step;
+		};
+
+		const auto xBegin = static_cast<std::uint32_t>(std::ceil(to_sample(triMinX, min.x, step.x)));
+		const auto xEnd = static_cast<std::uint32_t>(std::floor(to_sample(triMaxX, min.x, step.x)));
+		const auto yBegin = static_cast<std::uint32_t>(std::ceil(to_sample(triMinY, min.y, step.y)));
+		const auto yEnd = static_cast<std::uint32_t>(std::floor(to_sample(triMaxY, min.y, step.y)));
+
+		for (auto y = yBegin; y <= yEnd && y < size; ++y) {
+			for (auto x = xBegin; x <= xEnd && x < size; ++x) {
+				const float px = min.x + x * step.x;
+				const float py = min.y + y * step.y;
+
+				const float w1 = ((px - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (py - v0.y)) / area;
+				const float w2 = ((v1.x - v0.x) * (py - v0.y) - (px - v0.x) * (v1.y - v0.y)) / area;
+				const float w0 = 1.0f - w1 - w2;
+
+				constexpr float epsilon = -1e-4f;
+				if (w0 >= epsilon && w1 >= epsilon && w2 >= epsilon) {
+					auto& height = at(x, y);
+					height = std::max(height, w0 * v0.z + w1 * v1.z + w2 * v2.z);
+				}
+			}
+		}
+	}
+
+	void HeightField::Finalize()
+	{
+		valid = std::ranges::any_of(heights, [](float a_height) {
+			return !numeric::essentially_equal(a_height, -RE::NI_INFINITY);
+		});
+	}
+
+	bool HeightField::IsValid() const
+	{
+		return valid;
+	}
+
+	float HeightField::GetHeight(float a_x, float a_y) const
+	{
+		if (!valid) {
+			return -RE::NI_INFINITY;
+		}
+
+		const float fx = std::clamp((a_x - min.x) / step.x, 0.0f, static_cast<float>(size - 1));
+		const float fy = std::clamp((a_y - min.y) / step.y, 0.0f, static_cast<float>(size - 1));
+
+		const auto x0 = std::min(static_cast<std::uint32_t>(fx), size - 2);
+		const auto y0 = std::min(static_cast<std::uint32_t>(fy), size - 2);
+		const auto tx = fx - x0;
+		const auto ty = fy - y0;
+
+		const std::array corners{ at(x0, y0), at(x0 + 1, y0), at(x0, y0 + 1), at(x0 + 1, y0 + 1) };
+		const std::array weights{ (1.0f - tx) * (1.0f - ty), tx * (1.0f - ty), (1.0f - tx) * ty, tx * ty };
+
+		// renormalize over the corners that hit the water surface, so edges of the mesh don't drag the height down
+		float height = 0.0f;
+		float weightSum = 0.0f;
+		for (std::size_t i = 0; i < corners.size(); ++i) {
+			if (!numeric::essentially_equal(corners[i], -RE::NI_INFINITY)) {
+				height += corners[i] * weights[i];
+				weightSum += weights[i];
+			}
+		}
+
+		return weightSum > 0.0f ? height / weightSum : -RE::NI_INFINITY;
+	}
+
+	float SlopedWater::GetHeight(const RE::BSMultiBoundAABB* a_bound, const RE::NiPoint3& a_pos)
+	{
+		{
+			std::shared_lock sharedLock(lock);
+			if (const auto it = entries.find(a_bound); it != entries.end()) {
+				return it->second.field.GetHeight(a_pos.x, a_pos.y);
+			}
+		}
+
+		RequestUpdate();
+		return -RE::NI_INFINITY;
+	}
+
+	void SlopedWater::RequestUpdate()
+	{
+		if (!updateQueued.exchange(true, std::memory_order_acq_rel)) {
+			SKSE::GetTaskInterface()->AddTask([this]() { Update(); });
+		}
+	}
+
+	void SlopedWater::Update()
+	{
+		SPLASH_TRACE("SlopedWater::Update");
+
+		// misses from here on queue the next update
+		updateQueued.store(false, std::memory_order_release);
+
+		const auto waterSystem = RE::TESWaterSystem::GetSingleton();
+		if (!waterSystem) {
+			return;
+		}
+
+		// only this thread writes entries, so it can read them without the lock
+		std::unordered_set<const RE::BSMultiBoundAABB*>            loaded;
+		std::vector<std::pair<const RE::BSMultiBoundAABB*, Entry>> built;
+
+		for (const auto& waterObject : waterSystem->waterObjects) {
+			if (!waterObject) {
+				continue;
+			}
+
+			// mesh is walked once per water object, then shared by all of its sloped bounds
+			std::optional<std::vector<Triangle>> triangles;
+
+			for (const auto& bound : waterObject->multiBounds) {
+				if (!bound || !is_sloped(bound.get())) {
+					continue;
+				}
+
+				loaded.insert(bound.get());
+				if (entries.contains(bound.get())) {
+					continue;
+				}
+
+				if (!triangles) {
+					triangles = collect_triangles(waterObject->shape.get());
+				}
+
+				HeightField field(bound.get());
+				for (const auto& triangle : *triangles) {
+					field.Rasterize(triangle);
+				}
+				field.Finalize();
+
+				built.emplace_back(bound.get(), Entry{ bound, field });
+			}
+		}
+
+		std::unique_lock uniqueLock(lock);
+
+		// bounds of unloaded water drop out here
+		std::erase_if(entries, [&](const auto& a_entry) { return !loaded.contains(a_entry.first); });
+		for (auto& [bound, entry] : built) {
+			entries.emplace(bound, std::move(entry));
+		}
+	}
+
+	std::vector<Triangle> SlopedWater::collect_triangles(RE::NiAVObject* a_shape)
+	{
+		std::vector<Triangle> triangles;
+		if (!a_shape) {
+			return triangles;
+		}
+
+		RE::BSVisit::TraverseScenegraphGeometries(a_shape, [&](RE::BSGeometry* a_geometry) {
+			const auto triShape = a_geometry->AsTriShape();
+			const auto rendererData = triShape ? a_geometry->rendererData : nullptr;
+			if (!rendererData || !rendererData->rawVertexData || !rendererData->rawIndexData) {
+				return RE::BSVisit::BSVisitControl::kContinue;
+			}
+
+			const auto& vertexDesc = a_geometry->vertexDesc;
+			if (!vertexDesc.HasFlag(RE::BSGraphics::Vertex::Flags::VF_VERTEX)) {
+				return RE::BSVisit::BSVisitControl::kContinue;
+			}
+
+			const auto stride = vertexDesc.GetSize();
+			const auto fullPrecision = vertexDesc.HasFlag(RE::BSGraphics::Vertex::Flags::VF_FULLPREC);
+			const auto vertexData = rendererData->rawVertexData + vertexDesc.GetAttributeOffset(RE::BSGraphics::Vertex::Attribute::VA_POSITION);
+			const auto indexData = rendererData->rawIndexData;
+
+			const auto& world = a_geometry->world;
+			for (std::uint32_t i = 0; i < triShape->triangleCount; ++i) {
+				triangles.push_back({ world * detail::get_vertex(vertexData, stride, fullPrecision, indexData[i * 3]),
+					world * detail::get_vertex(vertexData, stride, fullPrecision, indexData[i * 3 + 1]),
+					world * detail::get_vertex(vertexData, stride, fullPrecision, indexData[i * 3 + 2]) });
+			}
+
+			return RE::BSVisit::BSVisitControl::kContinue;
+		});
+
+		return triangles;
+	}
+
+	void WaterObjects::Update()
+	{
+		SPLASH_TRACE("WaterObjects::Update");
+
+		pending.clear();
+		if (const auto waterSystem = RE::TESWaterSystem::GetSingleton()) {
+			for (const auto& waterObject : waterSystem->waterObjects) {
+				if (!waterObject) {
+					continue;
+				}
+				const auto waterForm = waterObject->waterType;
+				const bool dangerous = waterForm && waterForm->GetDangerous();
+				for (const auto& bound : waterObject->multiBounds) {
+					if (bound) {
+						const auto& size = bound->size;
+						const auto& center = bound->center;
+						pending.push_back({ bound, { center.x - size.x, center.y - size.y }, { center.x + size.x, center.y + size.y }, center.z, SlopedWater::is_sloped(bound.get()), dangerous });
+					}
+				}
+			}
+		}
+
+		{
+			std::unique_lock uniqueLock(lock);
+			bounds.swap(pending);
+		}
+
+		// releases bounds of unloaded water here on the main thread
+		pending.clear();
+	}
+
+	float WaterObjects::GetHeight(const RE::NiPoint3& a_pos)
+	{
+		const auto allowDamageWater = Settings::GetSingleton()->GetAllowDamageWater();
+
+		std::shared_lock sharedLock(lock);
+		for (const auto& bound : bounds) {
+			if ((bound.dangerous && !allowDamageWater) || a_pos.x < bound.min.x || a_pos.x > bound.max.x || a_pos.y < bound.min.y || a_pos.y > bound.max.y) {
+				continue;
+			}
+			if (!bound.sloped) {
+				return bound.height;
+			}
+			//sloped water (rivers, waterfalls), built on the main thread the first time the bound is hit
+			if (const auto height = SlopedWater::GetSingleton()->GetHeight(bound.bound.get(), a_pos); !numeric::essentially_equal(height, -RE::NI_INFINITY)) {
+				return height;
+			}
+		}
+
+		return -RE::NI_INFINITY;
+	}
+
+	void CellWater::Register()
+	{
+		if (const auto scripts = RE::ScriptEventSourceHolder::GetSingleton()) {
+			scripts->AddEventSink<RE::TESCellFullyLoadedEvent>(GetSingleton());
+			logger::info("Registered {}"sv, typeid(CellWater).name());
+		}
+	}
+
+	bool CellWater::HasWater(const RE::TESObjectCELL* a_cell)
+	{
+		// cells that haven't been evaluated yet are assumed wet, so the water queries still run
+		const auto entry = lookup(a_cell);
+		return !entry || entry->hasWater;
+	}
+
+	std::optional<float> CellWater::GetWaterHeight(const RE::TESObjectCELL* a_cell)
+	{
+		const auto entry = lookup(a_cell);
+		return entry ? std::optional(entry->waterHeight) : std::nullopt;
+	}
+
+	std::optional<CellWater::Entry> CellWater::lookup(const RE::TESObjectCELL* a_cell)
+	{
+		struct LastCell
+		{
+			const RE::TESObjectCELL* cell{ nullptr };
+			std::uint32_t            generation{ 0 };
+			std::optional<Entry>     entry;
+		};
+		thread_local LastCell last;
+
+		const auto currentGeneration = generation.load(std::memory_order_acquire);
+		if (last.cell == a_cell && last.generation == currentGeneration) {
+			return last.entry;
+		}
+
+		std::optional<Entry> entry;
+		{
+			std::shared_lock sharedLock(lock);
+			if (const auto it = entries.find(a_cell); it != entries.end() && it->second.formID == a_cell->GetFormID()) {
+				entry = it->second;
+			}
+		}
+
+		last = { a_cell, currentGeneration, entry };
+		return entry;
+	}
+
+	RE::BSEventNotifyControl CellWater::ProcessEvent(const RE::TESCellFullyLoadedEvent* a_event, RE::BSTEventSource<RE::TESCellFullyLoadedEvent>*)
+	{
+		if (!a_event || !a_event->cell) {
+			return RE::BSEventNotifyControl::kContinue;
+		}
+
+		SPLASH_TRACE("CellWater::ProcessEvent");
+
+		// a new cell can bring water within reach of its loaded neighbours, so only those are re-evaluated
+		std::vector<std::pair<const RE::TESObjectCELL*, Entry>> updated;
+		updated.emplace_back(a_event->cell, make_entry(a_event->cell));
+
+		const auto tes = RE::TES::GetSingleton();
+		const auto gridCells = tes ? tes->gridCells : nullptr;
+		if (const auto exterior = gridCells && a_event->cell->IsExteriorCell() ? a_event->cell->cellData.exterior : nullptr) {
+			for (std::uint32_t x = 0; x < gridCells->length; ++x) {
+				for (std::uint32_t y = 0; y < gridCells->length; ++y) {
+					const auto cell = gridCells->GetCell(x, y);
+					const auto neighbour = cell && cell != a_event->cell && cell->IsExteriorCell() ? cell->cellData.exterior : nullptr;
+					if (neighbour && std::abs(neighbour->cellX - exterior->cellX) <= 1 && std::abs(neighbour->cellY - exterior->cellY) <= 1) {
+						updated.emplace_back(cell, make_entry(cell));
+					}
+				}
+			}
+		}
+
+		{
+			std::unique_lock uniqueLock(lock);
+
+			// there is no cell detach event, so cells that left the loaded area are dropped here
+			std::erase_if(entries, [](const auto& a_entry) {
+				const auto cell = RE::TESForm::LookupByID<RE::TESObjectCELL>(a_entry.second.formID);
+				return cell != a_entry.first || !cell->IsAttached();
+			});
+
+			for (const auto& [cell, entry] : updated) {
+				entries.insert_or_assign(cell, entry);
+			}
+		}
+		generation.fetch_add(1, std::memory_order_release);
+
+		return RE::BSEventNotifyControl::kContinue;
+	}
+
+	CellWater::Entry CellWater::make_entry(const RE::TESObjectCELL* a_cell)
+	{
+		const auto waterHeight = a_cell->GetExteriorWaterHeight();
+		return { a_cell->GetFormID(), compute_has_water(a_cell, waterHeight), waterHeight };
+	}
+
+	bool CellWater::compute_has_water(const RE::TESObjectCELL* a_cell, float a_waterHeight)
+	{
+		SPLASH_TRACE("CellWater::compute");
+
+		const auto allowDamageWater = Settings::GetSingleton()->GetAllowDamageWater();
+
+		// cell water, ignoring exterior water levels that sit below all of the cell's terrain
+		if (a_cell->IsInteriorCell()) {
+			if (a_cell->cellFlags.any(RE::TESObjectCELL::Flag::kHasWater)) {
+				return true;
+			}
+		} else if (!numeric::essentially_equal(a_waterHeight, -RE::NI_INFINITY)) {
+			const auto land = a_cell->cellLand;
+			const auto loadedData = land ? land->loadedData : nullptr;
+			if (!loadedData || a_waterHeight > loadedData->heightExtents[0]) {
+				return true;
+			}
+		}
+
+		// placed water activators
+		bool hasWaterRef = false;
+		const_cast<RE::TESObjectCELL*>(a_cell)->ForEachReference([&](RE::TESObjectREFR& a_ref) {
+			const auto base = a_ref.GetBaseObject();
+			const auto activator = base ? base->As<RE::TESObjectACTI>() : nullptr;
+			if (activator && activator->IsWater()) {
+				hasWaterRef = true;
+				return RE::BSContainer::ForEachResult::kStop;
+			}
+			return RE::BSContainer::ForEachResult::kContinue;
+		});
+		if (hasWaterRef) {
+			return true;
+		}
+
+		// water system objects within a cell of this one, which covers water placed in loaded neighbours
+		const auto waterSystem = RE::TESWaterSystem::GetSingleton();
+		if (!waterSystem) {
+			return false;
+		}
+
+		constexpr float cellSize = 4096.0f;
+
+		RE::NiPoint2 cellMin{ -RE::NI_INFINITY, -RE::NI_INFINITY };
+		RE::NiPoint2 cellMax{ RE::NI_INFINITY, RE::NI_INFINITY };
+		if (const auto exterior = a_cell->IsExteriorCell() ? a_cell->cellData.exterior : nullptr) {
+			cellMin = { (exterior->cellX - 1) * cellSize, (exterior->cellY - 1) * cellSize };
+			cellMax = { (exterior->cellX + 2) * cellSize, (exterior->cellY + 2) * cellSize };
+		}
+
+		for (const auto& waterObject : waterSystem->waterObjects) {
+			if (!waterObject) {
+				continue;
+			}
+			if (!allowDamageWater) {
+				if (const auto waterForm = waterObject->waterType; waterForm && waterForm->GetDangerous()) {
+					continue;
+				}
+			}
+			for (const auto& bound : waterObject->multiBounds) {
+				if (bound) {
+					const auto boundMin = bound->center - bound->size;
+					const auto boundMax = bound->center + bound->size;
+					if (!(boundMax.x < cellMin.x || boundMin.x > cellMax.x || boundMax.y < cellMin.y || boundMin.y > cellMax.y)) {
+						return true;
+					}
+				}
+			}
+		}
+
+		return false;
+	}
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+namespace Splashes::Water
+{
+	using Triangle = std::array<RE::NiPoint3, 3>;
+
+	// coarse grid of surface heights over a sloped water bound, rasterized once from the water geometry
+	class HeightField
+	{
+	public:
+		HeightField() = default;
+		explicit HeightField(const RE::BSMultiBoundAABB* a_bound);
+
+		void Rasterize(const Triangle& a_triangle);
+		void Finalize();
+
+		[[nodiscard]] bool  IsValid() const;
+		[[nodiscard]] float GetHeight(float a_x, float a_y) const;
+
+	private:
+		static constexpr std::uint32_t size = 8;
+
+		[[nodiscard]] float& at(std::uint32_t a_x, std::uint32_t a_y) { return heights[a_y * size + a_x]; }
+		[[nodiscard]] float  at(std::uint32_t a_x, std::uint32_t a_y) const { return heights[a_y * size + a_x]; }
+
+		// members
+		RE::NiPoint2                   min{};
+		RE::NiPoint2                   max{};
+		RE::NiPoint2                   step{};
+		std::array<float, size * size> heights{};
+		bool                           valid{ false };
+	};
+
+	// height fields for every loaded sloped bound, built on the main thread and only read by the hooks
+	// a lookup for a bound without a field queues the build, so water added at any time is picked up
+	class SlopedWater : public ISingleton<SlopedWater>
+	{
+	public:
+		[[nodiscard]] float GetHeight(const RE::BSMultiBoundAABB* a_bound, const RE::NiPoint3& a_pos);
+
+		static bool is_sloped(const RE::BSMultiBoundAABB* a_bound) { return a_bound->size.z > 10.0f; }
+
+	private:
+		struct Entry
+		{
+			RE::NiPointer<RE::BSMultiBoundAABB> bound;  // keeps the key address from being reused
+			HeightField                         field;
+		};
+
+		void RequestUpdate();
+		void Update();
+
+		static std::vector<Triangle> collect_triangles(RE::NiAVObject* a_shape);
+
+		// members
+		std::shared_mutex                                      lock;
+		std::unordered_map<const RE::BSMultiBoundAABB*, Entry> entries;
+		std::atomic_bool                                       updateQueued{ false };
+	};
+
+	// bounds of every loaded water object, copied once per frame on the main thread so the hooks never walk the water system
+	class WaterObjects : public ISingleton<WaterObjects>
+	{
+	public:
+		void Update();
+
+		// -NI_INFINITY if no water object covers the position
+		[[nodiscard]] float GetHeight(const RE::NiPoint3& a_pos);
+
+	private:
+		struct Bound
+		{
+			RE::NiPointer<RE::BSMultiBoundAABB> bound;  // sloped height fields are keyed by it
+			RE::NiPoint2                        min;
+			RE::NiPoint2                        max;
+			float                               height;
+			bool                                sloped;
+			bool                                dangerous;
+		};
+
+		// members
+		std::shared_mutex  lock;
+		std::vector<Bound> bounds;
+		std::vector<Bound> pending;  // main thread only
+	};
+
+	// whether any water is reachable from a loaded cell, so dry cells can skip the water queries entirely
+	// evaluated on the main thread as cells load, the hooks only look it up
+	class CellWater :
+		public ISingleton<CellWater>,
+		public RE::BSTEventSink<RE::TESCellFullyLoadedEvent>
+	{
+	public:
+		static void Register();
+
+		bool HasWater(const RE::TESObjectCELL* a_cell);
+
+		// the cell's own water height, nullopt if the cell hasn't been evaluated yet
+		std::optional<float> GetWaterHeight(const RE::TESObjectCELL* a_cell);
+
+	protected:
+		RE::BSEventNotifyControl ProcessEvent(const RE::TESCellFullyLoadedEvent* a_event, RE::BSTEventSource<RE::TESCellFullyLoadedEvent>*) override;
+
+	private:
+		struct Entry
+		{
+			RE::FormID formID;
+			bool       hasWater;
+			float      waterHeight;
+		};
+
+		std::optional<Entry> lookup(const RE::TESObjectCELL* a_cell);
+
+		static Entry make_entry(const RE::TESObjectCELL* a_cell);
+		static bool  compute_has_water(const RE::TESObjectCELL* a_cell, float a_waterHeight);
+
+		// members
+		std::shared_mutex                                   lock;
+		std::unordered_map<const RE::TESObjectCELL*, Entry> entries;
+		std::atomic_uint32_t                                generation{ 0 };  // bumped when loaded neighbours change
+	};
+}
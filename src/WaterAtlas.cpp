@@ -0,0 +1,172 @@
+#include "WaterAtlas.h"
+
+#include "Trace.h"
+
+namespace Splashes::Water
+{
+	static_assert(AtlasFormat::noWater == -RE::NI_INFINITY);
+
+	void Atlas::LoadOrBake()
+	{
+		SPLASH_TRACE("Atlas::LoadOrBake");
+
+		const std::filesystem::path path{ L"Data/SKSE/Plugins/po3_SplashesOfSkyrim_WaterAtlas.bin" };
+
+		const auto loadOrderHash = get_load_order_hash();
+		if (Map(path, loadOrderHash)) {
+			logger::info("Loaded water atlas ({} worldspaces, {} cells)"sv, view.worldSpaces.size(), view.cells.size());
+			return;
+		}
+
+		auto grids = read_grids();
+		if (!grids) {
+			logger::warn("Water atlas not baked, water queries fall back to runtime lookups"sv);
+			return;
+		}
+
+		const auto data = AtlasFormat::Bake(loadOrderHash, std::move(*grids));
+		{
+			std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				logger::error("Failed to write water atlas to {}"sv, path.string());
+				return;
+			}
+			file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		}
+
+		if (Map(path, loadOrderHash)) {
+			logger::info("Baked water atlas ({} worldspaces, {} cells)"sv, view.worldSpaces.size(), view.cells.size());
+		} else {
+			logger::error("Failed to map baked water atlas {}"sv, path.string());
+		}
+	}
+
+	const Atlas::Cell* Atlas::GetCell(RE::FormID a_worldSpace, const RE::NiPoint3& a_pos) const
+	{
+		return view.Find(a_worldSpace, a_pos.x, a_pos.y);
+	}
+
+	std::uint64_t Atlas::get_load_order_hash()
+	{
+		// FNV-1a over active plugins in load order, with their size and write time so edited plugins rebake
+		std::uint64_t hash = 0xCBF29CE484222325;
+		const auto    hash_bytes = [&](const void* a_data, std::size_t a_size) {
+			const auto bytes = static_cast<const std::uint8_t*>(a_data);
+			for (std::size_t i = 0; i < a_size; ++i) {
+				hash = (hash ^ bytes[i]) * 0x100000001B3;
+			}
+		};
+
+		hash_bytes(&AtlasFormat::version, sizeof(AtlasFormat::version));
+
+		if (const auto dataHandler = RE::TESDataHandler::GetSingleton()) {
+			for (const auto& file : dataHandler->files) {
+				if (file && file->compileIndex != 0xFF) {
+					std::string name(file->GetFilename());
+					std::ranges::transform(name, name.begin(), [](unsigned char a_char) { return static_cast<char>(std::tolower(a_char)); });
+					hash_bytes(name.data(), name.size());
+					hash_bytes(&file->compileIndex, sizeof(file->compileIndex));
+
+					const auto      path = get_plugin_path(file);
+					std::error_code ec;
+
+					const std::uint64_t size = std::filesystem::file_size(path, ec);
+					hash_bytes(&size, sizeof(size));
+
+					const auto writeTime = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+					hash_bytes(&writeTime, sizeof(writeTime));
+				}
+			}
+		}
+
+		return hash;
+	}
+
+	std::optional<std::vector<AtlasFormat::Grid>> Atlas::read_grids()
+	{
+		SPLASH_TRACE("Atlas::read_grids");
+
+		std::vector<AtlasFormat::WorldSpaceRecord> worldSpaces;
+		std::vector<AtlasFormat::CellRecord>       cells;
+
+		const auto dataHandler = RE::TESDataHandler::GetSingleton();
+		for (const auto& file : dataHandler->files) {
+			if (!file || file->compileIndex == 0xFF) {
+				continue;
+			}
+
+			// a plugin that can't be read could override any cell, so a partial atlas is never written
+			mmio::mapped_file_source plugin;
+			if (!plugin.open(get_plugin_path(file))) {
+				logger::warn("Water atlas : failed to open {}"sv, file->GetFilename());
+				return std::nullopt;
+			}
+			auto records = AtlasFormat::ReadPlugin({ reinterpret_cast<const std::byte*>(plugin.data()), plugin.size() });
+			if (!records) {
+				logger::warn("Water atlas : failed to read {}"sv, file->GetFilename());
+				return std::nullopt;
+			}
+
+			// record FormIDs index into the plugin's masters, or the plugin itself past the last master
+			const auto resolve = [&](std::uint32_t a_formID) -> std::uint32_t {
+				const auto index = a_formID >> 24;
+				const auto owner = index < records->masters.size() ? dataHandler->LookupModByName(records->masters[index]) : file;
+				return owner ? get_load_order_formID(owner, a_formID) : 0;
+			};
+
+			for (auto& worldSpace : records->worldSpaces) {
+				worldSpace.formID = resolve(worldSpace.formID);
+				worldSpace.parent = worldSpace.parent != 0 ? resolve(worldSpace.parent) : 0;
+				if (worldSpace.formID != 0) {
+					worldSpaces.push_back(worldSpace);
+				}
+			}
+			for (auto& cell : records->cells) {
+				cell.formID = resolve(cell.formID);
+				cell.worldSpace = resolve(cell.worldSpace);
+				if (cell.formID != 0 && cell.worldSpace != 0) {
+					cells.push_back(cell);
+				}
+			}
+		}
+
+		return AtlasFormat::MakeGrids(worldSpaces, cells);
+	}
+
+	std::uint32_t Atlas::get_load_order_formID(const RE::TESFile* a_file, std::uint32_t a_formID)
+	{
+#ifndef SKYRIMVR
+		if (a_file->IsLight()) {
+			return 0xFE000000 | (static_cast<std::uint32_t>(a_file->smallFileCompileIndex) << 12) | (a_formID & 0xFFF);
+		}
+#endif
+		return (static_cast<std::uint32_t>(a_file->compileIndex) << 24) | (a_formID & 0xFFFFFF);
+	}
+
+	std::filesystem::path Atlas::get_plugin_path(const RE::TESFile* a_file)
+	{
+		return std::filesystem::path{ L"Data" } / std::string(a_file->GetFilename());
+	}
+
+	bool Atlas::Map(const std::filesystem::path& a_path, std::uint64_t a_loadOrderHash)
+	{
+		view = {};
+		if (mapping.is_open()) {
+			mapping.close();
+		}
+
+		std::error_code ec;
+		if (!std::filesystem::exists(a_path, ec) || !mapping.open(a_path)) {
+			return false;
+		}
+
+		const auto mapped = AtlasFormat::Open({ reinterpret_cast<const std::byte*>(mapping.data()), mapping.size() }, a_loadOrderHash);
+		if (!mapped) {
+			mapping.close();
+			return false;
+		}
+
+		view = *mapped;
+		return true;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "WaterAtlasFormat.h"
+
+namespace Splashes::Water
+{
+	// per-worldspace grid of cell water heights, baked from the plugins' cell records and memory mapped from disk
+	class Atlas : public ISingleton<Atlas>
+	{
+	public:
+		using Cell = AtlasFormat::Cell;
+
+		void LoadOrBake();
+
+		// nullptr for cells the atlas knows nothing about
+		[[nodiscard]] const Cell* GetCell(RE::FormID a_worldSpace, const RE::NiPoint3& a_pos) const;
+
+	private:
+		static std::uint64_t                                 get_load_order_hash();
+		static std::optional<std::vector<AtlasFormat::Grid>> read_grids();
+		static std::uint32_t                                 get_load_order_formID(const RE::TESFile* a_file, std::uint32_t a_formID);
+		static std::filesystem::path                         get_plugin_path(const RE::TESFile* a_file);
+
+		bool Map(const std::filesystem::path& a_path, std::uint64_t a_loadOrderHash);
+
+		// members
+		mmio::mapped_file_source mapping;
+		AtlasFormat::View        view;
+	};
+}
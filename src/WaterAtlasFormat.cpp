@@ -0,0 +1,427 @@
+#include "WaterAtlasFormat.h"
+
+namespace Splashes::Water
+{
+	namespace detail
+	{
+		using Tag = std::array<char, 4>;
+
+		constexpr Tag make_tag(const char (&a_str)[5])
+		{
+			return { a_str[0], a_str[1], a_str[2], a_str[3] };
+		}
+
+		template <class T>
+		T read(std::span<const std::byte> a_data, std::size_t a_offset)
+		{
+			T value{};
+			std::memcpy(&value, a_data.data() + a_offset, sizeof(T));
+			return value;
+		}
+
+		enum GROUP_TYPE : std::int32_t
+		{
+			kTop = 0,
+			kWorldChildren = 1,
+			kExteriorCellBlock = 4,
+			kExteriorCellSubBlock = 5
+		};
+
+		constexpr std::size_t   headerSize = 0x18;  // records and groups
+		constexpr std::uint32_t compressedFlag = 0x40000;
+		constexpr std::uint32_t deletedFlag = 0x20;
+		constexpr std::uint8_t  interiorCellFlag = 0x01;
+		constexpr std::uint8_t  hasWaterCellFlag = 0x02;
+		constexpr std::uint8_t  useParentWaterFlag = 0x08;
+		constexpr float         defaultWaterHeight = 2147483600.0f;  // XCLW at or above this uses the worldspace default
+
+		constexpr AtlasFormat::Cell unknownCell{ AtlasFormat::noWater, 0 };
+
+		// XXXX sets the size of the subrecord that follows it, for fields over 64k
+		template <class F>
+		bool for_each_subrecord(std::span<const std::byte> a_data, F&& a_func)
+		{
+			std::size_t   pos = 0;
+			std::uint32_t largeSize = 0;
+			while (pos < a_data.size()) {
+				if (a_data.size() - pos < 6) {
+					return false;
+				}
+				const auto  type = read<Tag>(a_data, pos);
+				std::size_t size = read<std::uint16_t>(a_data, pos + 4);
+				pos += 6;
+
+				if (largeSize != 0) {
+					size = std::exchange(largeSize, 0);
+				}
+				if (size > a_data.size() - pos) {
+					return false;
+				}
+
+				if (type == make_tag("XXXX")) {
+					if (size != 4) {
+						return false;
+					}
+					largeSize = read<std::uint32_t>(a_data, pos);
+				} else {
+					a_func(type, a_data.subspan(pos, size));
+				}
+				pos += size;
+			}
+			return true;
+		}
+
+		void read_world_space(std::uint32_t a_formID, std::uint32_t a_flags, std::span<const std::byte> a_data, AtlasFormat::PluginRecords& a_records)
+		{
+			AtlasFormat::WorldSpaceRecord record{ a_formID, 0, false, std::nullopt };
+
+			if ((a_flags & (compressedFlag | deletedFlag)) == 0) {
+				const auto valid = for_each_subrecord(a_data, [&](const Tag& a_type, std::span<const std::byte> a_field) {
+					if (a_type == make_tag("WNAM") && a_field.size() >= 4) {
+						record.parent = read<std::uint32_t>(a_field, 0);
+					} else if (a_type == make_tag("PNAM") && !a_field.empty()) {
+						record.useParentWater = (read<std::uint8_t>(a_field, 0) & useParentWaterFlag) != 0;
+					} else if (a_type == make_tag("DNAM") && a_field.size() >= 8) {
+						record.defaultWaterHeight = read<float>(a_field, 4);
+					}
+				});
+				if (!valid) {
+					record = { a_formID, 0, false, std::nullopt };
+				}
+			}
+
+			a_records.worldSpaces.push_back(record);
+		}
+
+		void read_cell(std::uint32_t a_formID, std::uint32_t a_flags, std::uint32_t a_worldSpace, std::span<const std::byte> a_data, AtlasFormat::PluginRecords& a_records)
+		{
+			AtlasFormat::CellRecord record{ a_formID, a_worldSpace, 0, 0, false, false, std::nullopt };
+
+			if ((a_flags & (compressedFlag | deletedFlag)) != 0) {
+				a_records.cells.push_back(record);
+				return;
+			}
+
+			std::optional<std::uint8_t>                          cellFlags;
+			std::optional<std::pair<std::int32_t, std::int32_t>> coords;
+
+			const auto valid = for_each_subrecord(a_data, [&](const Tag& a_type, std::span<const std::byte> a_field) {
+				if (a_type == make_tag("DATA") && !a_field.empty()) {
+					cellFlags = read<std::uint8_t>(a_field, 0);
+				} else if (a_type == make_tag("XCLC") && a_field.size() >= 8) {
+					coords = { read<std::int32_t>(a_field, 0), read<std::int32_t>(a_field, 4) };
+				} else if (a_type == make_tag("XCLW") && a_field.size() >= 4) {
+					record.waterHeight = read<float>(a_field, 0);
+				}
+			});
+
+			if (valid && !coords) {  // persistent cell, holds the worldspace's persistent references
+				return;
+			}
+			if (valid && cellFlags) {
+				if ((*cellFlags & interiorCellFlag) != 0) {
+					return;
+				}
+				record.x = coords->first;
+				record.y = coords->second;
+				record.readable = true;
+				record.hasWater = (*cellFlags & hasWaterCellFlag) != 0;
+			} else {
+				record.waterHeight.reset();
+			}
+
+			a_records.cells.push_back(record);
+		}
+
+		// only descends into worldspace groups, everything else (including cell children) is skipped by size
+		bool read_groups(std::span<const std::byte> a_data, std::size_t a_begin, std::size_t a_end, std::uint32_t a_worldSpace, AtlasFormat::PluginRecords& a_records)
+		{
+			auto pos = a_begin;
+			while (pos < a_end) {
+				if (a_end - pos < headerSize) {
+					return false;
+				}
+
+				const auto type = read<Tag>(a_data, pos);
+				const auto size = read<std::uint32_t>(a_data, pos + 4);
+
+				if (type == make_tag("GRUP")) {
+					if (size < headerSize || size > a_end - pos) {
+						return false;
+					}
+
+					const auto begin = pos + headerSize;
+					const auto end = pos + size;
+
+					bool valid = true;
+					switch (read<std::int32_t>(a_data, pos + 12)) {
+					case kTop:
+						if (read<Tag>(a_data, pos + 8) == make_tag("WRLD")) {
+							valid = read_groups(a_data, begin, end, 0, a_records);
+						}
+						break;
+					case kWorldChildren:
+						valid = read_groups(a_data, begin, end, read<std::uint32_t>(a_data, pos + 8), a_records);
+						break;
+					case kExteriorCellBlock:
+					case kExteriorCellSubBlock:
+						valid = read_groups(a_data, begin, end, a_worldSpace, a_records);
+						break;
+					default:
+						break;
+					}
+					if (!valid) {
+						return false;
+					}
+
+					pos = end;
+				} else {
+					if (size > a_end - pos - headerSize) {
+						return false;
+					}
+
+					const auto flags = read<std::uint32_t>(a_data, pos + 8);
+					const auto formID = read<std::uint32_t>(a_data, pos + 12);
+					const auto payload = a_data.subspan(pos + headerSize, size);
+
+					if (type == make_tag("WRLD")) {
+						read_world_space(formID, flags, payload, a_records);
+					} else if (type == make_tag("CELL") && a_worldSpace != 0) {
+						read_cell(formID, flags, a_worldSpace, payload, a_records);
+					}
+
+					pos += headerSize + size;
+				}
+			}
+			return true;
+		}
+	}
+
+	std::optional<AtlasFormat::PluginRecords> AtlasFormat::ReadPlugin(std::span<const std::byte> a_data)
+	{
+		using namespace detail;
+
+		if (a_data.size() < headerSize || read<Tag>(a_data, 0) != make_tag("TES4")) {
+			return std::nullopt;
+		}
+
+		const auto headerDataSize = read<std::uint32_t>(a_data, 4);
+		if (headerDataSize > a_data.size() - headerSize) {
+			return std::nullopt;
+		}
+
+		PluginRecords records;
+
+		const auto valid = for_each_subrecord(a_data.subspan(headerSize, headerDataSize), [&](const Tag& a_type, std::span<const std::byte> a_field) {
+			if (a_type == make_tag("MAST")) {
+				const auto name = std::string_view(reinterpret_cast<const char*>(a_field.data()), a_field.size());
+				records.masters.emplace_back(name.substr(0, name.find('\0')));
+			}
+		});
+		if (!valid || !read_groups(a_data, headerSize + headerDataSize, a_data.size(), 0, records)) {
+			return std::nullopt;
+		}
+
+		return records;
+	}
+
+	std::vector<AtlasFormat::Grid> AtlasFormat::MakeGrids(const std::vector<WorldSpaceRecord>& a_worldSpaces, const std::vector<CellRecord>& a_cells)
+	{
+		std::unordered_map<std::uint32_t, const WorldSpaceRecord*> worldSpaces;
+		for (const auto& worldSpace : a_worldSpaces) {
+			worldSpaces.insert_or_assign(worldSpace.formID, &worldSpace);
+		}
+
+		const auto get_default_water_height = [&](std::uint32_t a_worldSpace) -> std::optional<float> {
+			for (std::uint32_t depth = 0; depth < 8; ++depth) {  // parent chains are short, this only guards against cycles
+				const auto it = worldSpaces.find(a_worldSpace);
+				if (it == worldSpaces.end()) {
+					return std::nullopt;
+				}
+				if (!it->second->useParentWater || it->second->parent == 0) {
+					return it->second->defaultWaterHeight;
+				}
+				a_worldSpace = it->second->parent;
+			}
+			return std::nullopt;
+		};
+
+		struct Placed
+		{
+			std::uint32_t worldSpace;
+			std::int32_t  x;
+			std::int32_t  y;
+			Cell          cell;
+		};
+
+		std::unordered_map<std::uint32_t, Placed> placed;  // by cell FormID, so overrides replace their masters
+		for (const auto& record : a_cells) {
+			if (!record.readable) {
+				// an override we can't read, the cell keeps its place but nothing is known about it
+				if (const auto it = placed.find(record.formID); it != placed.end()) {
+					it->second.cell = detail::unknownCell;
+				}
+				continue;
+			}
+
+			Cell cell{ noWater, 1 };
+			if (record.hasWater) {
+				if (record.waterHeight && *record.waterHeight < detail::defaultWaterHeight) {
+					cell.height = *record.waterHeight;
+				} else if (const auto defaultHeight = get_default_water_height(record.worldSpace)) {
+					cell.height = *defaultHeight;
+				} else {
+					cell = detail::unknownCell;
+				}
+			}
+			placed.insert_or_assign(record.formID, Placed{ record.worldSpace, record.x, record.y, cell });
+		}
+
+		std::map<std::uint32_t, std::vector<const Placed*>> byWorldSpace;
+		for (const auto& cell : placed | std::views::values) {
+			byWorldSpace[cell.worldSpace].push_back(&cell);
+		}
+
+		std::vector<Grid> grids;
+		for (const auto& [worldSpace, cells] : byWorldSpace) {
+			const auto [minX, maxX] = std::ranges::minmax(cells | std::views::transform([](const Placed* a_cell) { return a_cell->x; }));
+			const auto [minY, maxY] = std::ranges::minmax(cells | std::views::transform([](const Placed* a_cell) { return a_cell->y; }));
+
+			constexpr auto coordMin = std::numeric_limits<std::int16_t>::min();
+			constexpr auto coordMax = std::numeric_limits<std::int16_t>::max();
+			if (minX < coordMin || minY < coordMin || maxX > coordMax || maxY > coordMax) {
+				continue;
+			}
+
+			const auto width = static_cast<std::size_t>(maxX - minX + 1);
+			const auto height = static_cast<std::size_t>(maxY - minY + 1);
+			if (width * height > maxGridCells) {
+				continue;
+			}
+
+			Grid grid{
+				worldSpace,
+				static_cast<std::int16_t>(minX),
+				static_cast<std::int16_t>(minY),
+				static_cast<std::uint16_t>(width),
+				static_cast<std::uint16_t>(height),
+				std::vector<Cell>(width * height, detail::unknownCell)
+			};
+
+			std::vector<bool> occupied(width * height, false);
+			for (const auto& cell : cells) {
+				const auto index = static_cast<std::size_t>(cell->y - minY) * width + static_cast<std::size_t>(cell->x - minX);
+				// two records claiming the same cell, neither can be trusted
+				grid.cells[index] = occupied[index] ? detail::unknownCell : cell->cell;
+				occupied[index] = true;
+			}
+
+			grids.push_back(std::move(grid));
+		}
+
+		return grids;
+	}
+
+	std::vector<std::byte> AtlasFormat::Bake(std::uint64_t a_loadOrderHash, std::vector<Grid> a_grids)
+	{
+		std::ranges::sort(a_grids, {}, &Grid::worldSpace);
+
+		std::vector<WorldSpace> worldSpaceData;
+		std::vector<Cell>       cellData;
+
+		for (const auto& grid : a_grids) {
+			if (grid.cells.size() != static_cast<std::size_t>(grid.width) * grid.height) {
+				continue;
+			}
+			worldSpaceData.push_back({ grid.worldSpace, grid.minX, grid.minY, grid.width, grid.height, static_cast<std::uint32_t>(cellData.size()) });
+			cellData.insert(cellData.end(), grid.cells.begin(), grid.cells.end());
+		}
+
+		const Header header{ magic, version, a_loadOrderHash, static_cast<std::uint32_t>(worldSpaceData.size()), static_cast<std::uint32_t>(cellData.size()) };
+
+		std::vector<std::byte> data(sizeof(Header) + worldSpaceData.size() * sizeof(WorldSpace) + cellData.size() * sizeof(Cell));
+
+		auto out = data.data();
+		std::memcpy(out, &header, sizeof(Header));
+		out += sizeof(Header);
+		std::memcpy(out, worldSpaceData.data(), worldSpaceData.size() * sizeof(WorldSpace));
+		out += worldSpaceData.size() * sizeof(WorldSpace);
+		std::memcpy(out, cellData.data(), cellData.size() * sizeof(Cell));
+
+		return data;
+	}
+
+	bool AtlasFormat::Validate(std::span<const std::byte> a_data, std::uint64_t a_loadOrderHash)
+	{
+		if (a_data.size() < sizeof(Header)) {
+			return false;
+		}
+
+		Header header{};
+		std::memcpy(&header, a_data.data(), sizeof(Header));
+
+		if (header.magic != magic || header.version != version || header.loadOrderHash != a_loadOrderHash) {
+			return false;
+		}
+
+		const auto expectedSize = sizeof(Header) + static_cast<std::size_t>(header.worldSpaceCount) * sizeof(WorldSpace) + static_cast<std::size_t>(header.cellCount) * sizeof(Cell);
+		if (a_data.size() != expectedSize) {
+			return false;
+		}
+
+		std::uint32_t lastFormID = 0;
+		for (std::uint32_t i = 0; i < header.worldSpaceCount; ++i) {
+			WorldSpace worldSpace{};
+			std::memcpy(&worldSpace, a_data.data() + sizeof(Header) + i * sizeof(WorldSpace), sizeof(WorldSpace));
+
+			if (i > 0 && worldSpace.formID <= lastFormID) {  // lookups rely on sorted worldspaces
+				return false;
+			}
+			if (static_cast<std::size_t>(worldSpace.cellOffset) + static_cast<std::size_t>(worldSpace.width) * worldSpace.height > header.cellCount) {
+				return false;
+			}
+			lastFormID = worldSpace.formID;
+		}
+
+		return true;
+	}
+
+	std::optional<AtlasFormat::View> AtlasFormat::Open(std::span<const std::byte> a_data, std::uint64_t a_loadOrderHash)
+	{
+		if (!Validate(a_data, a_loadOrderHash)) {
+			return std::nullopt;
+		}
+
+		Header header{};
+		std::memcpy(&header, a_data.data(), sizeof(Header));
+
+		const auto worldSpaceData = a_data.data() + sizeof(Header);
+		const auto cellData = worldSpaceData + header.worldSpaceCount * sizeof(WorldSpace);
+
+		return View{
+			{ reinterpret_cast<const WorldSpace*>(worldSpaceData), header.worldSpaceCount },
+			{ reinterpret_cast<const Cell*>(cellData), header.cellCount }
+		};
+	}
+
+	const AtlasFormat::Cell* AtlasFormat::View::Find(std::uint32_t a_worldSpace, float a_x, float a_y) const
+	{
+		const auto it = std::ranges::lower_bound(worldSpaces, a_worldSpace, {}, &WorldSpace::formID);
+		if (it == worldSpaces.end() || it->formID != a_worldSpace) {
+			return nullptr;
+		}
+
+		// comparisons are written so NaN falls outside the grid too
+		const auto cellX = std::floor(a_x / cellSize);
+		const auto cellY = std::floor(a_y / cellSize);
+		if (!(cellX >= it->minX && cellX < it->minX + it->width && cellY >= it->minY && cellY < it->minY + it->height)) {
+			return nullptr;
+		}
+
+		const auto x = static_cast<std::uint32_t>(cellX - it->minX);
+		const auto y = static_cast<std::uint32_t>(cellY - it->minY);
+
+		const auto& cell = cells[it->cellOffset + y * it->width + x];
+		return cell.known ? &cell : nullptr;
+	}
+}
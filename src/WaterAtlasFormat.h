@@ -0,0 +1,106 @@
+#pragma once
+
+namespace Splashes::Water
+{
+	// on-disk layout of the water atlas and the plugin record reader it is baked from
+	// kept free of engine types so it can be tested, or run offline, without the game
+	struct AtlasFormat
+	{
+		static constexpr std::uint32_t       version = 3;
+		static constexpr std::array<char, 4> magic{ 'S', 'P', 'W', 'A' };
+		static constexpr float               cellSize = 4096.0f;
+		static constexpr float               noWater = -std::numeric_limits<float>::max();  // -RE::NI_INFINITY
+		static constexpr std::size_t         maxGridCells = 1 << 20;
+
+		struct Header
+		{
+			std::array<char, 4> magic;
+			std::uint32_t       version;
+			std::uint64_t       loadOrderHash;
+			std::uint32_t       worldSpaceCount;
+			std::uint32_t       cellCount;
+		};
+		static_assert(sizeof(Header) == 0x18);
+
+		struct WorldSpace
+		{
+			std::uint32_t formID;
+			std::int16_t  minX;
+			std::int16_t  minY;
+			std::uint16_t width;
+			std::uint16_t height;
+			std::uint32_t cellOffset;
+		};
+		static_assert(sizeof(WorldSpace) == 0x10);
+
+		struct Cell
+		{
+			[[nodiscard]] bool HasWater() const { return height != noWater; }
+
+			// members
+			float         height;  // noWater if the cell has no water
+			std::uint32_t known;   // cell record was read, unknown cells fall back to the runtime lookup
+		};
+		static_assert(sizeof(Cell) == 0x8);
+
+		struct Grid
+		{
+			std::uint32_t     worldSpace;
+			std::int16_t      minX;
+			std::int16_t      minY;
+			std::uint16_t     width;
+			std::uint16_t     height;
+			std::vector<Cell> cells;  // row major, width * height
+		};
+
+		// WRLD record, FormIDs are relative to the plugin's masters until resolved
+		struct WorldSpaceRecord
+		{
+			std::uint32_t        formID;
+			std::uint32_t        parent;  // 0 if none
+			bool                 useParentWater;
+			std::optional<float> defaultWaterHeight;  // nullopt if missing or the record couldn't be read
+		};
+
+		// exterior CELL record, FormIDs are relative to the plugin's masters until resolved
+		struct CellRecord
+		{
+			std::uint32_t        formID;
+			std::uint32_t        worldSpace;
+			std::int32_t         x;
+			std::int32_t         y;
+			bool                 readable;  // false for compressed or deleted records, the cell becomes unknown
+			bool                 hasWater;
+			std::optional<float> waterHeight;  // XCLW, the worldspace default applies if missing
+		};
+
+		struct PluginRecords
+		{
+			std::vector<std::string>      masters;
+			std::vector<WorldSpaceRecord> worldSpaces;
+			std::vector<CellRecord>       cells;
+		};
+
+		// indexed lookups into a validated atlas
+		struct View
+		{
+			// nullptr for cells the atlas knows nothing about
+			[[nodiscard]] const Cell* Find(std::uint32_t a_worldSpace, float a_x, float a_y) const;
+
+			// members
+			std::span<const WorldSpace> worldSpaces;
+			std::span<const Cell>       cells;
+		};
+
+		// nullopt if the plugin is malformed
+		[[nodiscard]] static std::optional<PluginRecords> ReadPlugin(std::span<const std::byte> a_data);
+
+		// records with resolved FormIDs, in load order so later records override earlier ones
+		[[nodiscard]] static std::vector<Grid> MakeGrids(const std::vector<WorldSpaceRecord>& a_worldSpaces, const std::vector<CellRecord>& a_cells);
+
+		// grids whose cell count doesn't match width * height are skipped
+		[[nodiscard]] static std::vector<std::byte> Bake(std::uint64_t a_loadOrderHash, std::vector<Grid> a_grids);
+		[[nodiscard]] static bool                   Validate(std::span<const std::byte> a_data, std::uint64_t a_loadOrderHash);
+		[[nodiscard]] static std::optional<View>    Open(std::span<const std::byte> a_data, std::uint64_t a_loadOrderHash);
+	};
+}
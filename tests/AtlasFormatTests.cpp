@@ -0,0 +1,474 @@
+#include "WaterAtlasFormat.h"
+
+namespace
+{
+	using Splashes::Water::AtlasFormat;
+
+	constexpr std::uint64_t loadOrderHash = 0x1234'5678'9ABC'DEF0;
+
+	std::uint32_t failures = 0;
+
+	void check(bool a_condition, std::string_view a_test, std::string_view a_what)
+	{
+		if (!a_condition) {
+			std::fprintf(stderr, "FAILED %.*s : %.*s\n", static_cast<int>(a_test.size()), a_test.data(), static_cast<int>(a_what.size()), a_what.data());
+			++failures;
+		}
+	}
+
+	bool same_cell(const AtlasFormat::Cell& a_lhs, const AtlasFormat::Cell& a_rhs)
+	{
+		return a_lhs.height == a_rhs.height && a_lhs.known == a_rhs.known;
+	}
+
+	constexpr AtlasFormat::Cell unknown{ AtlasFormat::noWater, 0 };
+	constexpr AtlasFormat::Cell dry{ AtlasFormat::noWater, 1 };
+
+	// synthetic plugin data
+
+	struct Bytes : std::vector<std::byte>
+	{
+		template <class T>
+		Bytes& put(const T& a_value)
+		{
+			const auto bytes = reinterpret_cast<const std::byte*>(&a_value);
+			insert(end(), bytes, bytes + sizeof(T));
+			return *this;
+		}
+
+		Bytes& put_tag(const char (&a_tag)[5])
+		{
+			for (std::size_t i = 0; i < 4; ++i) {
+				put(a_tag[i]);
+			}
+			return *this;
+		}
+
+		Bytes& append(const Bytes& a_other)
+		{
+			insert(end(), a_other.begin(), a_other.end());
+			return *this;
+		}
+	};
+
+	template <class... Args>
+	Bytes concat(const Args&... a_parts)
+	{
+		Bytes result;
+		(result.append(a_parts), ...);
+		return result;
+	}
+
+	template <class T>
+	Bytes subrecord(const char (&a_type)[5], const T& a_value)
+	{
+		Bytes result;
+		result.put_tag(a_type).put(static_cast<std::uint16_t>(sizeof(T))).put(a_value);
+		return result;
+	}
+
+	Bytes subrecord_bytes(const char (&a_type)[5], const Bytes& a_data)
+	{
+		Bytes result;
+		result.put_tag(a_type).put(static_cast<std::uint16_t>(a_data.size())).append(a_data);
+		return result;
+	}
+
+	Bytes record(const char (&a_type)[5], std::uint32_t a_formID, const Bytes& a_data, std::uint32_t a_flags = 0)
+	{
+		Bytes result;
+		result.put_tag(a_type).put(static_cast<std::uint32_t>(a_data.size())).put(a_flags).put(a_formID);
+		result.put(std::uint32_t{ 0 }).put(std::uint16_t{ 44 }).put(std::uint16_t{ 0 });
+		return result.append(a_data);
+	}
+
+	Bytes group(std::uint32_t a_label, std::int32_t a_type, const Bytes& a_contents)
+	{
+		Bytes result;
+		result.put_tag("GRUP").put(static_cast<std::uint32_t>(24 + a_contents.size())).put(a_label).put(a_type);
+		result.put(std::uint32_t{ 0 }).put(std::uint32_t{ 0 });
+		return result.append(a_contents);
+	}
+
+	Bytes top_group(const char (&a_label)[5], const Bytes& a_contents)
+	{
+		std::uint32_t label{};
+		std::memcpy(&label, a_label, 4);
+		return group(label, 0, a_contents);
+	}
+
+	Bytes cell(std::uint32_t a_formID, std::int32_t a_x, std::int32_t a_y, std::uint8_t a_flags, std::optional<float> a_waterHeight, std::uint32_t a_recordFlags = 0)
+	{
+		Bytes data = concat(subrecord("DATA", a_flags), subrecord("XCLC", std::array<std::int32_t, 3>{ a_x, a_y, 0 }));
+		if (a_waterHeight) {
+			data.append(subrecord("XCLW", *a_waterHeight));
+		}
+		return record("CELL", a_formID, data, a_recordFlags);
+	}
+
+	Bytes make_plugin()
+	{
+		Bytes master;
+		for (const auto c : "Skyrim.esm"sv) {
+			master.put(c);
+		}
+		master.put('\0');
+
+		const auto header = record("TES4", 0, concat(subrecord("HEDR", std::array<std::uint32_t, 3>{}), subrecord_bytes("MAST", master), subrecord("DATA", std::uint64_t{ 0 })));
+
+		const auto statics = top_group("STAT", record("STAT", 0x01000001, {}));
+		const auto interiors = top_group("CELL", group(0, 2, group(0, 3, cell(0x01000002, 5, 5, 0x03, 10.0f))));
+
+		// large field through XXXX, the following subrecord carries a zero size
+		Bytes large;
+		large.put_tag("XXXX").put(std::uint16_t{ 4 }).put(std::uint32_t{ 8 });
+		large.put_tag("OFST").put(std::uint16_t{ 0 }).put(std::uint64_t{ 0 });
+
+		const auto children = concat(
+			record("CELL", 0x0100000B, subrecord("DATA", std::uint8_t{ 0x02 })),  // persistent cell, no XCLC
+			group(0x0100000B, 6, record("REFR", 0x01000010, {})),
+			group(0, 4, group(0, 5, concat(
+				cell(0x0100000C, -1, -2, 0x02, 50.0f),
+				group(0x0100000C, 6, group(0x0100000C, 9, record("LAND", 0x01000011, {}))),
+				cell(0x0100000D, 0, 0, 0x00, std::nullopt),
+				record("CELL", 0x0100000E, concat(large, subrecord("DATA", std::uint8_t{ 0x02 }), subrecord("XCLC", std::array<std::int32_t, 2>{ 1, 0 }), subrecord("XCLW", 2147483648.0f))),
+				cell(0x00000F00, 2, 0, 0x02, 1.0f, 0x40000),
+				record("CELL", 0x0100000F, concat(subrecord("XCLC", std::array<std::int32_t, 2>{ 3, 0 }), subrecord_bytes("DATA", {}).append(Bytes{}.put_tag("XCLW").put(std::uint16_t{ 64 }))))))));
+
+		const auto worldSpaces = top_group("WRLD", concat(
+			record("WRLD", 0x0100000A, subrecord("DNAM", std::array<float, 2>{ -2048.0f, -1000.0f })),
+			group(0x0100000A, 1, children),
+			record("WRLD", 0x0000003C, concat(subrecord("WNAM", std::uint32_t{ 0x0100000A }), subrecord("PNAM", std::uint16_t{ 0x08 })))));
+
+		return concat(header, statics, interiors, worldSpaces);
+	}
+
+	// baked atlas data
+
+	AtlasFormat::Grid make_grid(std::uint32_t a_worldSpace, std::uint16_t a_width, std::uint16_t a_height)
+	{
+		AtlasFormat::Grid grid{ a_worldSpace, -2, -3, a_width, a_height, {} };
+		for (std::uint32_t i = 0; i < static_cast<std::uint32_t>(a_width) * a_height; ++i) {
+			grid.cells.push_back({ static_cast<float>(i) * 16.0f, i % 2 });
+		}
+		return grid;
+	}
+
+	std::vector<std::byte> bake_two()
+	{
+		return AtlasFormat::Bake(loadOrderHash, { make_grid(0x3C, 2, 2), make_grid(0x1A, 3, 1) });
+	}
+
+	template <class T>
+	void write_at(std::vector<std::byte>& a_data, std::size_t a_offset, const T& a_value)
+	{
+		std::memcpy(a_data.data() + a_offset, &a_value, sizeof(T));
+	}
+
+	constexpr std::size_t world_space_offset(std::size_t a_index)
+	{
+		return sizeof(AtlasFormat::Header) + a_index * sizeof(AtlasFormat::WorldSpace);
+	}
+
+	// tests
+
+	void read_plugin()
+	{
+		constexpr auto test = "read_plugin"sv;
+
+		const auto plugin = make_plugin();
+		const auto records = AtlasFormat::ReadPlugin(plugin);
+		check(records.has_value(), test, "plugin is read");
+		if (!records) {
+			return;
+		}
+
+		check(records->masters == std::vector<std::string>{ "Skyrim.esm" }, test, "masters");
+
+		check(records->worldSpaces.size() == 2, test, "worldspace count");
+		if (records->worldSpaces.size() == 2) {
+			const auto& own = records->worldSpaces[0];
+			check(own.formID == 0x0100000A && own.parent == 0 && !own.useParentWater && own.defaultWaterHeight == -1000.0f, test, "worldspace defaults");
+			const auto& child = records->worldSpaces[1];
+			check(child.formID == 0x0000003C && child.parent == 0x0100000A && child.useParentWater && !child.defaultWaterHeight, test, "worldspace parent");
+		}
+
+		// persistent and interior cells are skipped, so are cell children
+		check(records->cells.size() == 5, test, "cell count");
+		if (records->cells.size() == 5) {
+			const auto& wet = records->cells[0];
+			check(wet.formID == 0x0100000C && wet.worldSpace == 0x0100000A && wet.x == -1 && wet.y == -2, test, "cell coords");
+			check(wet.readable && wet.hasWater && wet.waterHeight == 50.0f, test, "cell water");
+
+			const auto& dryCell = records->cells[1];
+			check(dryCell.readable && !dryCell.hasWater && !dryCell.waterHeight, test, "dry cell");
+
+			const auto& large = records->cells[2];
+			check(large.readable && large.hasWater && large.x == 1 && large.waterHeight == 2147483648.0f, test, "XXXX sized field is skipped");
+
+			const auto& compressed = records->cells[3];
+			check(compressed.formID == 0x00000F00 && !compressed.readable, test, "compressed cell is unreadable");
+
+			const auto& broken = records->cells[4];
+			check(broken.formID == 0x0100000F && !broken.readable, test, "cell with a truncated field is unreadable");
+		}
+	}
+
+	void rejects_malformed_plugin()
+	{
+		constexpr auto test = "rejects_malformed_plugin"sv;
+
+		const auto plugin = make_plugin();
+		check(!AtlasFormat::ReadPlugin(std::span(plugin).first(plugin.size() - 1)), test, "truncated group");
+		check(!AtlasFormat::ReadPlugin(std::span(plugin).first(10)), test, "truncated header");
+		check(!AtlasFormat::ReadPlugin({}), test, "empty buffer");
+
+		auto noHeader = plugin;
+		std::memcpy(noHeader.data(), "TES3", 4);
+		check(!AtlasFormat::ReadPlugin(noHeader), test, "missing TES4");
+
+		auto badGroup = plugin;
+		const auto statOffset = 24 + 12 + 6 + 11 + 6 + 8 + 6;  // TES4 header and fields
+		write_at(badGroup, statOffset + 4, std::uint32_t{ 8 });
+		check(!AtlasFormat::ReadPlugin(badGroup), test, "group smaller than its header");
+	}
+
+	void make_grids()
+	{
+		constexpr auto test = "make_grids"sv;
+
+		const std::vector<AtlasFormat::WorldSpaceRecord> worldSpaces{
+			{ 0x10, 0, false, 100.0f },
+			{ 0x20, 0x10, true, std::nullopt },
+			{ 0x30, 0, false, std::nullopt },
+			{ 0x10, 0, false, 120.0f },  // override
+		};
+
+		const std::vector<AtlasFormat::CellRecord> cells{
+			{ 0x100, 0x10, -1, -1, true, true, 5.0f },
+			{ 0x101, 0x10, 0, -1, true, true, std::nullopt },
+			{ 0x102, 0x10, 1, 0, true, false, std::nullopt },
+			{ 0x103, 0x10, 0, 0, true, true, 2147483648.0f },
+			{ 0x200, 0x20, 3, 3, true, true, std::nullopt },
+			{ 0x300, 0x30, 0, 0, true, true, std::nullopt },
+			{ 0x101, 0x10, 0, -1, true, false, std::nullopt },  // override drops the water
+			{ 0x100, 0x10, 0, 0, false, false, std::nullopt },  // override we couldn't read
+			{ 0x999, 0x10, 9, 9, false, false, std::nullopt },  // never placed, ignored
+			{ 0x104, 0x10, 1, 0, true, true, 7.0f },            // same cell as 0x102
+			{ 0x400, 0x40, 0, 0, true, false, std::nullopt },
+			{ 0x401, 0x40, 2000, 2000, true, false, std::nullopt },  // grid too large
+			{ 0x500, 0x50, 40000, 0, true, false, std::nullopt },    // outside int16 cell coordinates
+		};
+
+		const auto grids = AtlasFormat::MakeGrids(worldSpaces, cells);
+		check(grids.size() == 3, test, "oversized grids are skipped");
+		if (grids.size() != 3) {
+			return;
+		}
+
+		const auto& main = grids[0];
+		check(main.worldSpace == 0x10 && main.minX == -1 && main.minY == -1 && main.width == 3 && main.height == 2, test, "grid bounds");
+		check(main.cells.size() == 6, test, "grid cell count");
+		if (main.cells.size() == 6) {
+			check(same_cell(main.cells[0], unknown), test, "unreadable override forgets the cell");
+			check(same_cell(main.cells[1], dry), test, "later record wins");
+			check(same_cell(main.cells[2], unknown) && same_cell(main.cells[3], unknown), test, "gaps are unknown");
+			check(same_cell(main.cells[4], { 120.0f, 1 }), test, "default water height marker uses the worldspace override");
+			check(same_cell(main.cells[5], unknown), test, "conflicting cells are unknown");
+		}
+
+		check(grids[1].worldSpace == 0x20 && grids[1].cells.size() == 1 && same_cell(grids[1].cells[0], { 120.0f, 1 }), test, "parent water height");
+		check(grids[2].worldSpace == 0x30 && grids[2].cells.size() == 1 && same_cell(grids[2].cells[0], unknown), test, "missing default height is unknown");
+	}
+
+	void round_trip()
+	{
+		constexpr auto test = "round_trip"sv;
+
+		const auto data = bake_two();
+		check(AtlasFormat::Validate(data, loadOrderHash), test, "baked atlas is valid");
+		check(data.size() == sizeof(AtlasFormat::Header) + 2 * sizeof(AtlasFormat::WorldSpace) + 7 * sizeof(AtlasFormat::Cell), test, "size");
+
+		AtlasFormat::Header header{};
+		std::memcpy(&header, data.data(), sizeof(header));
+		check(header.magic == AtlasFormat::magic && header.version == AtlasFormat::version && header.loadOrderHash == loadOrderHash, test, "header");
+		check(header.worldSpaceCount == 2 && header.cellCount == 7, test, "counts");
+
+		std::array<AtlasFormat::WorldSpace, 2> worldSpaces{};
+		std::memcpy(worldSpaces.data(), data.data() + world_space_offset(0), sizeof(worldSpaces));
+		check(worldSpaces[0].formID == 0x1A && worldSpaces[1].formID == 0x3C, test, "worldspaces sorted by formID");
+		check(worldSpaces[0].cellOffset == 0 && worldSpaces[1].cellOffset == 3, test, "cell offsets");
+		check(worldSpaces[1].minX == -2 && worldSpaces[1].minY == -3 && worldSpaces[1].width == 2 && worldSpaces[1].height == 2, test, "grid bounds");
+
+		AtlasFormat::Cell cell{};
+		std::memcpy(&cell, data.data() + world_space_offset(2) + 4 * sizeof(AtlasFormat::Cell), sizeof(cell));
+		check(same_cell(cell, { 16.0f, 1 }), test, "cell data");
+
+		check(AtlasFormat::Validate(AtlasFormat::Bake(loadOrderHash, {}), loadOrderHash), test, "empty atlas is valid");
+	}
+
+	void rejects_header_mismatch()
+	{
+		constexpr auto test = "rejects_header_mismatch"sv;
+
+		auto badMagic = bake_two();
+		write_at(badMagic, offsetof(AtlasFormat::Header, magic), std::array{ 'S', 'P', 'W', 'X' });
+		check(!AtlasFormat::Validate(badMagic, loadOrderHash), test, "magic");
+
+		auto badVersion = bake_two();
+		write_at(badVersion, offsetof(AtlasFormat::Header, version), AtlasFormat::version + 1);
+		check(!AtlasFormat::Validate(badVersion, loadOrderHash), test, "version");
+
+		check(!AtlasFormat::Validate(bake_two(), loadOrderHash + 1), test, "load order hash");
+	}
+
+	void rejects_size_mismatch()
+	{
+		constexpr auto test = "rejects_size_mismatch"sv;
+
+		const auto data = bake_two();
+		check(!AtlasFormat::Validate(std::span(data).first(data.size() - 1), loadOrderHash), test, "truncated cells");
+		check(!AtlasFormat::Validate(std::span(data).first(sizeof(AtlasFormat::Header) - 1), loadOrderHash), test, "truncated header");
+		check(!AtlasFormat::Validate({}, loadOrderHash), test, "empty buffer");
+
+		auto oversized = data;
+		oversized.push_back(std::byte{ 0 });
+		check(!AtlasFormat::Validate(oversized, loadOrderHash), test, "trailing bytes");
+	}
+
+	void rejects_unsorted_world_spaces()
+	{
+		constexpr auto test = "rejects_unsorted_world_spaces"sv;
+
+		auto unsorted = bake_two();
+		write_at(unsorted, world_space_offset(0) + offsetof(AtlasFormat::WorldSpace, formID), std::uint32_t{ 0x3C });
+		write_at(unsorted, world_space_offset(1) + offsetof(AtlasFormat::WorldSpace, formID), std::uint32_t{ 0x1A });
+		check(!AtlasFormat::Validate(unsorted, loadOrderHash), test, "descending formIDs");
+
+		auto duplicate = bake_two();
+		write_at(duplicate, world_space_offset(1) + offsetof(AtlasFormat::WorldSpace, formID), std::uint32_t{ 0x1A });
+		check(!AtlasFormat::Validate(duplicate, loadOrderHash), test, "duplicate formIDs");
+	}
+
+	void rejects_cell_offset_out_of_range()
+	{
+		constexpr auto test = "rejects_cell_offset_out_of_range"sv;
+
+		auto pastEnd = bake_two();
+		write_at(pastEnd, world_space_offset(1) + offsetof(AtlasFormat::WorldSpace, cellOffset), std::uint32_t{ 4 });  // 4 + 2 * 2 > 7
+		check(!AtlasFormat::Validate(pastEnd, loadOrderHash), test, "grid runs past the cells");
+
+		auto overflow = bake_two();
+		write_at(overflow, world_space_offset(1) + offsetof(AtlasFormat::WorldSpace, cellOffset), std::numeric_limits<std::uint32_t>::max());
+		check(!AtlasFormat::Validate(overflow, loadOrderHash), test, "offset near uint32 max");
+	}
+
+	void skips_mismatched_grid()
+	{
+		constexpr auto test = "skips_mismatched_grid"sv;
+
+		auto mismatched = make_grid(0x20, 2, 2);
+		mismatched.cells.pop_back();
+
+		const auto data = AtlasFormat::Bake(loadOrderHash, { make_grid(0x3C, 2, 2), mismatched, make_grid(0x1A, 3, 1) });
+		check(AtlasFormat::Validate(data, loadOrderHash), test, "remaining atlas is valid");
+		check(data == bake_two(), test, "mismatched grid is left out");
+	}
+
+	void find_cells()
+	{
+		constexpr auto test = "find_cells"sv;
+
+		// 0x10 covers cells x -2..0, y -1..0, 0x20 is a single cell behind it
+		AtlasFormat::Grid grid{ 0x10, -2, -1, 3, 2, {} };
+		for (std::uint32_t i = 0; i < 6; ++i) {
+			grid.cells.push_back({ static_cast<float>(i), i == 4 ? 0u : 1u });
+		}
+		const auto data = AtlasFormat::Bake(loadOrderHash, { grid, { 0x20, 5, 5, 1, 1, { { 99.0f, 1 } } } });
+
+		check(!AtlasFormat::Open(data, loadOrderHash + 1), test, "open rejects a stale atlas");
+
+		const auto view = AtlasFormat::Open(data, loadOrderHash);
+		check(view.has_value(), test, "open");
+		if (!view) {
+			return;
+		}
+
+		const auto height_at = [&](std::uint32_t a_worldSpace, float a_x, float a_y) -> std::optional<float> {
+			const auto cell = view->Find(a_worldSpace, a_x, a_y);
+			return cell ? std::optional(cell->height) : std::nullopt;
+		};
+
+		check(height_at(0x10, -8192.0f, -4096.0f) == 0.0f, test, "grid origin");
+		check(height_at(0x10, -0.5f, -0.5f) == 1.0f, test, "negative positions floor to the lower cell");
+		check(height_at(0x10, 4095.9f, 0.0f) == 5.0f, test, "last cell");
+		check(height_at(0x10, -4096.0f, 10.0f) == std::nullopt, test, "unknown cell");
+
+		check(height_at(0x10, -8192.5f, 0.0f) == std::nullopt, test, "just below min x");
+		check(height_at(0x10, 4096.0f, 0.0f) == std::nullopt, test, "just past max x");
+		check(height_at(0x10, 0.0f, -4096.5f) == std::nullopt, test, "just below min y");
+		check(height_at(0x10, 0.0f, 4096.0f) == std::nullopt, test, "just past max y");
+		check(height_at(0x10, std::numeric_limits<float>::quiet_NaN(), 0.0f) == std::nullopt, test, "NaN");
+		check(height_at(0x10, 1e30f, -1e30f) == std::nullopt, test, "far outside");
+
+		check(height_at(0x20, 5.0f * 4096.0f + 1.0f, 5.0f * 4096.0f) == 99.0f, test, "second worldspace uses its cell offset");
+		check(height_at(0x30, 0.0f, 0.0f) == std::nullopt, test, "unknown worldspace");
+	}
+
+	void plugin_to_lookup()
+	{
+		constexpr auto test = "plugin_to_lookup"sv;
+
+		const auto records = AtlasFormat::ReadPlugin(make_plugin());
+		if (!records) {
+			check(false, test, "plugin is read");
+			return;
+		}
+
+		const auto data = AtlasFormat::Bake(loadOrderHash, AtlasFormat::MakeGrids(records->worldSpaces, records->cells));
+		const auto view = AtlasFormat::Open(data, loadOrderHash);
+		check(view.has_value(), test, "open");
+		if (!view) {
+			return;
+		}
+
+		const auto wet = view->Find(0x0100000A, -1.0f, -6144.0f);
+		check(wet && wet->HasWater() && wet->height == 50.0f, test, "cell water height");
+
+		const auto dryCell = view->Find(0x0100000A, 10.0f, 10.0f);
+		check(dryCell && !dryCell->HasWater(), test, "dry cell");
+
+		const auto defaulted = view->Find(0x0100000A, 4096.0f, 0.0f);
+		check(defaulted && defaulted->height == -1000.0f, test, "worldspace default height");
+
+		check(!view->Find(0x0100000A, 3.0f * 4096.0f, 0.0f), test, "unreadable cell");
+	}
+}
+
+int main()
+{
+	const std::array<void (*)(), 11> tests{
+		read_plugin,
+		rejects_malformed_plugin,
+		make_grids,
+		round_trip,
+		rejects_header_mismatch,
+		rejects_size_mismatch,
+		rejects_unsorted_world_spaces,
+		rejects_cell_offset_out_of_range,
+		skips_mismatched_grid,
+		find_cells,
+		plugin_to_lookup
+	};
+	for (const auto& test : tests) {
+		test();
+	}
+
+	if (failures > 0) {
+		std::fprintf(stderr, "%u check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::printf("All atlas format tests passed\n");
+	return 0;
+}